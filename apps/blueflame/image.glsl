@@ -1,16 +1,7 @@
-#version 460 core
-
 // Created by anatole duprat - XT95/2013
 // License Creative Commons Attribution-NonCommercial-ShareAlike 3.0 Unported License.
 // https://www.shadertoy.com/view/MdX3zr
 
-layout (location = 0) out vec4 fragColor;
-
-layout(location = 0) in vec2 v_TexCoord;
-
-layout(location = 0) uniform float iTime;
-layout(location = 1) uniform vec2 iResolution;
-
 float noise(vec3 p) //Thx to Las^Mercury
 {
 	vec3 i = floor(p);
@@ -58,10 +49,8 @@ vec4 raymarch(vec3 org, vec3 dir)
 	return vec4(p,glow);
 }
 
-void main()
+void mainImage(out vec4 fragColor, in vec2 fragCoord)
 {
-	vec2 fragCoord = gl_FragCoord.xy;
-
 	vec2 v = -1.0 + 2.0 * fragCoord.xy / iResolution.xy;
 	v.x *= iResolution.x/iResolution.y;
 	
@@ -142,8 +142,9 @@ public:
         GL(glGenVertexArrays(1, &VAO));
         GL(glGenBuffers(1, &VBO));
 
-        GL(glBindVertexArray(VAO));
-        GL(glBindBuffer(GL_ARRAY_BUFFER, VBO));
+        BlotGL::GLState &gl = BlotGL::GLState::current();
+        gl.bind_vertex_array(VAO);
+        gl.bind_buffer(GL_ARRAY_BUFFER, VBO);
         GL(glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW));
 
         GL(glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0));
@@ -154,7 +155,7 @@ public:
         for (int c = 0; c < m_color_count; ++c)
             GL(glDrawArrays(GL_TRIANGLES, c*3, 3));
 
-        GL(glDeleteVertexArrays(1, &VAO));
-        GL(glDeleteBuffers(1, &VBO));
+        gl.delete_vertex_arrays(1, &VAO);
+        gl.delete_buffers(1, &VBO);
     }
 };
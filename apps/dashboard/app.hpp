@@ -0,0 +1,122 @@
+#pragma once
+#include <array>
+#include <cmath>
+
+extern "C" {
+#include <GL/gl.h>
+#include <GL/glext.h>
+};
+
+#include "blotgl_shader.hpp"
+#include "blotgl_app.hpp"
+#include "blotgl_glerror.hpp"
+
+// a grid of static panels, each with a small animated gauge; only the gauges
+// are reported as damage, so only they get redrawn, read back and sent
+class AppLayer : public BlotGL::Layer {
+protected:
+    static constexpr const char *vertexShaderSource = R"glsl(
+        #version 330 core
+        uniform vec4 u_rect;    // x0, y0, x1, y1 in view pixels
+        uniform vec2 u_size;
+        void main() {
+            vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+            vec2 pos = mix(u_rect.xy, u_rect.zw, corner) / u_size;
+            gl_Position = vec4(pos * 2.0 - 1.0, 0.0, 1.0);
+        }
+    )glsl";
+
+    static constexpr const char *fragmentShaderSource = R"glsl(
+        #version 330 core
+        uniform vec3 u_color;
+        out vec4 FragColor;
+        void main() {
+            FragColor = vec4(u_color, 1.0);
+        }
+    )glsl";
+
+    static constexpr int COLUMNS = 3;
+    static constexpr int ROWS = 2;
+    static constexpr int PANELS = COLUMNS * ROWS;
+
+    struct Rect {
+        float x0, y0, x1, y1;
+    };
+
+    BlotGL::Shader m_shader;
+    GLuint m_vertex_array{};
+    GLint m_rect_location{};
+    GLint m_size_location{};
+    GLint m_color_location{};
+
+    float m_width{}, m_height{};
+    std::array<Rect, PANELS> m_panels{};
+    std::array<Rect, PANELS> m_gauges{};    // the whole track each gauge fills
+    std::array<float, PANELS> m_levels{};
+
+    void draw(const Rect &rect, float r, float g, float b) {
+        BlotGL::GLState &gl = BlotGL::GLState::current();
+        gl.uniform(m_rect_location, rect.x0, rect.y0, rect.x1, rect.y1);
+        gl.uniform(m_color_location, r, g, b);
+        GL(glDrawArrays(GL_TRIANGLE_STRIP, 0, 4));
+    }
+
+public:
+    explicit AppLayer()
+    : BlotGL::Layer(), m_shader(vertexShaderSource, fragmentShaderSource)
+    {
+        track_damage();
+        GL(glGenVertexArrays(1, &m_vertex_array));
+
+        // Shader doesn't hand out its program, it is current after use()
+        m_shader.use();
+        GLint program{};
+        GL(glGetIntegerv(GL_CURRENT_PROGRAM, &program));
+        m_rect_location = glGetUniformLocation(program, "u_rect");
+        m_size_location = glGetUniformLocation(program, "u_size");
+        m_color_location = glGetUniformLocation(program, "u_color");
+    }
+    ~AppLayer()
+    {
+        BlotGL::GLState::current().delete_vertex_arrays(1, &m_vertex_array);
+    }
+
+    void on_update(const BlotGL::App &app, float timestamp) override
+    {
+        auto [width, height] = app.get_dimensions();
+        m_width = width;
+        m_height = height;
+
+        float pw = width / COLUMNS, ph = height / ROWS;
+        for (int i = 0; i < PANELS; i++) {
+            float x = (i % COLUMNS) * pw, y = (i / COLUMNS) * ph;
+            m_panels[i] = { x + 2, y + 2, x + pw - 2, y + ph - 2 };
+            // a short horizontal bar in the middle of the panel
+            m_gauges[i] = { x + pw * 0.2f, y + ph * 0.45f, x + pw * 0.8f, y + ph * 0.55f };
+            m_levels[i] = 0.5f + 0.5f * std::sin(timestamp * (0.7f + 0.3f * i) + i);
+            damage({ int(std::floor(m_gauges[i].x0)), int(std::floor(m_gauges[i].y0)),
+                     unsigned(std::ceil(m_gauges[i].x1 - m_gauges[i].x0)) + 1,
+                     unsigned(std::ceil(m_gauges[i].y1 - m_gauges[i].y0)) + 1 });
+        }
+    }
+
+    void on_render() override
+    {
+        BlotGL::GLState &gl = BlotGL::GLState::current();
+        m_shader.use();
+        gl.uniform(m_size_location, m_width, m_height);
+        gl.bind_vertex_array(m_vertex_array);
+
+        for (int i = 0; i < PANELS; i++) {
+            const Rect &p = m_panels[i];
+            draw(p, 0.15f, 0.2f, 0.3f);
+            draw({ p.x0 + 2, p.y0 + 2, p.x1 - 2, p.y1 - 2 }, 0.05f, 0.05f, 0.08f);
+
+            const Rect &g = m_gauges[i];
+            float level = m_levels[i];
+            draw(g, 0.1f, 0.1f, 0.1f);
+            draw({ g.x0, g.y0, g.x0 + (g.x1 - g.x0) * level, g.y1 },
+                 level, 1.0f - level, 0.2f);
+        }
+    }
+};
@@ -0,0 +1,150 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "blotgl_pixel_layer.hpp"
+
+// Conway's life, one cell per pixel, wrapping around at the edges.  Each
+// generation is computed on the worker pool straight into the output, a run of
+// rows per call: a row of the next generation only reads three of this one.
+// Live cells are white, dead ones fade out through yellow and red.
+class AppLayer : public BlotGL::PixelLayer {
+protected:
+    static constexpr float GENERATIONS_PER_SECOND = 20.0f;
+    static constexpr unsigned RESEED_EVERY = 100;   // generations between fresh patches
+    static constexpr uint8_t ALIVE = 255;           // dead cells count down from below it
+    static constexpr uint8_t FADE = 10;             // per generation
+
+    unsigned m_width{};
+    unsigned m_height{};
+    std::vector<uint8_t> m_cells;   // generation m_generation
+    std::vector<uint8_t> m_next;    // the one render_rows() computes
+    int64_t m_generation{-1};
+    int64_t m_origin{};             // generation the board was seeded at
+    bool m_step{};                  // this frame shows a new generation
+    std::array<std::array<uint8_t,3>,256> m_palette{};
+
+    void seed(std::minstd_rand &rng, unsigned x0, unsigned y0, unsigned width, unsigned height) {
+        std::bernoulli_distribution alive(0.3);
+        for (unsigned y = y0; y < y0 + height; y++)
+            for (unsigned x = x0; x < x0 + width; x++)
+                m_cells[size_t(y % m_height) * m_width + x % m_width] = alive(rng) ? ALIVE : 0;
+    }
+
+    // back to the board at m_origin; the random numbers only depend on the
+    // generation, so every instance plays the same game
+    void restart() {
+        std::minstd_rand rng(uint32_t(m_origin) + 1);
+        seed(rng, 0, 0, m_width, m_height);
+        m_generation = m_origin;
+    }
+
+    // make m_cells ready to compute the next generation from, which is now
+    // m_generation: a patch of noise now and then, so it never settles down
+    void begin_generation() {
+        m_generation ++;
+        if (m_generation % RESEED_EVERY == 0) {
+            std::minstd_rand rng(uint32_t(m_generation) + 1);
+            unsigned size = std::max(4u, std::min(m_width, m_height) / 4);
+            seed(rng, rng() % m_width, rng() % m_height, size, size);
+        }
+    }
+
+    const uint8_t* row(unsigned y) const { return &m_cells[size_t(y) * m_width]; }
+
+    // no branches, so the loop over a row vectorizes
+    static uint8_t next(uint8_t cell, uint8_t neighbours) {
+        bool alive = cell == ALIVE;
+        bool born = (neighbours == 3) | (alive & (neighbours == 2));
+        uint8_t faded = cell > FADE ? cell - FADE : 0;
+        return born ? ALIVE : alive ? ALIVE - 1 : faded;
+    }
+
+    // next generation of row y, from the rows around it
+    void step_row(unsigned y) {
+        const uint8_t *up = row((y + m_height - 1) % m_height);
+        const uint8_t *mid = row(y);
+        const uint8_t *down = row((y + 1) % m_height);
+        uint8_t *out = &m_next[size_t(y) * m_width];
+        const unsigned w = m_width;
+
+        auto count = [&](unsigned l, unsigned x, unsigned r) {
+            return uint8_t((up[l] == ALIVE) + (up[x] == ALIVE) + (up[r] == ALIVE)
+                         + (mid[l] == ALIVE) + (mid[r] == ALIVE)
+                         + (down[l] == ALIVE) + (down[x] == ALIVE) + (down[r] == ALIVE));
+        };
+        // the edges wrap, everything between is one branch-free loop
+        out[0] = next(mid[0], count(w - 1, 0, w > 1 ? 1 : 0));
+        for (unsigned x = 1; x + 1 < w; x++)
+            out[x] = next(mid[x], count(x - 1, x, x + 1));
+        if (w > 1)
+            out[w - 1] = next(mid[w - 1], count(w - 2, w - 1, 0));
+    }
+
+public:
+    explicit AppLayer()
+    : BlotGL::PixelLayer()
+    {
+        // black, red, yellow for the dying, white for the living
+        for (unsigned v = 0; v < ALIVE; v++) {
+            float t = float(v) / (ALIVE - 1);
+            m_palette[v] = { uint8_t(std::min(1.0f, t * 2.0f) * 255),
+                             uint8_t(std::max(0.0f, t * 2.0f - 1.0f) * 200), 0 };
+        }
+        m_palette[ALIVE] = { 255, 255, 255 };
+    }
+
+    // the board only depends on the timestamp, not on which frames came before
+    // (an export worker sees only some of them): generations skipped since the
+    // last frame are caught up here, and the board starts over if time went back
+    void on_update(const BlotGL::App &app, float timestamp) override {
+        // what the last frame computed is the generation now
+        if (m_step)
+            std::swap(m_cells, m_next);
+        m_step = false;
+
+        int64_t generation = int64_t(timestamp * GENERATIONS_PER_SECOND);
+        const BlotGL::Viewport &viewport = app.get_viewport();
+        if (viewport.width != m_width || viewport.height != m_height) {
+            m_width = viewport.width;
+            m_height = viewport.height;
+            m_cells.assign(size_t(m_width) * m_height, 0);
+            m_next.assign(m_cells.size(), 0);
+            // a new layer starts at generation 0, a resized one from where it is
+            m_origin = m_generation < 0 ? 0 : generation;
+            restart();
+        } else if (generation < m_generation) {
+            restart();
+        }
+        if (!m_width || !m_height)
+            return;
+
+        // all but the last one here, that one render_rows() computes on the pool
+        while (m_generation + 1 < generation) {
+            begin_generation();
+            for (unsigned y = 0; y < m_height; y++)
+                step_row(y);
+            std::swap(m_cells, m_next);
+        }
+        m_step = m_generation < generation;
+        if (m_step)
+            begin_generation();
+    }
+
+    void render_rows(const BlotGL::PixelView &view, unsigned begin, unsigned end) override {
+        for (unsigned y = begin; y < end; y++) {
+            const uint8_t *cells = row(y);
+            if (m_step) {
+                step_row(y);
+                cells = &m_next[size_t(y) * m_width];
+            }
+            uint8_t *rgb = view.row(y);
+            for (unsigned x = 0; x < view.width; x++, rgb += 3)
+                std::memcpy(rgb, m_palette[cells[x]].data(), 3);
+        }
+    }
+};
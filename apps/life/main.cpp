@@ -0,0 +1,17 @@
+#include <cstdio>
+#include <cstdlib>
+#include <fmt/core.h>
+
+#include "app.hpp"
+
+int main() {
+    // nothing here needs a GPU
+    BlotGL::Config config = BlotGL::Config::from_env();
+    config.gl = false;
+
+    BlotGL::App app(config);
+
+    app.push<AppLayer>();
+
+    return app.run();
+}
@@ -0,0 +1,32 @@
+#define GL_GLEXT_PROTOTYPES
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cassert>
+#include <fmt/core.h>
+#include <fmt/ostream.h>
+
+#include "blotgl_app.hpp"
+#include "blotgl_media_layer.hpp"
+
+// plays raw RGB24 frames, e.g. made with
+//   ffmpeg -i in.mp4 -vf scale=320:-2 -f rawvideo -pix_fmt rgb24 out.rgb
+int main(int argc, char *argv[]) {
+    if (argc < 4) {
+        fmt::println(stderr, "usage: {} <file.rgb> <width> <height> [fps]", argv[0]);
+        return 1;
+    }
+
+    BlotGL::MediaSource source{
+        .path = argv[1],
+        .width = unsigned(std::atoi(argv[2])),
+        .height = unsigned(std::atoi(argv[3])),
+        .fps = argc > 4 ? std::atof(argv[4]) : 30.0,
+    };
+
+    BlotGL::App app;
+
+    app.push<BlotGL::MediaLayer>({}, source);
+
+    return app.run();
+}
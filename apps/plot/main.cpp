@@ -0,0 +1,127 @@
+#define GL_GLEXT_PROTOTYPES
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+#include <fmt/core.h>
+
+extern "C" {
+#include <poll.h>
+#include <unistd.h>
+};
+
+#include "blotgl_app.hpp"
+#include "blotgl_plot_layer.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+// a few made up signals, `rate` samples per second each, in 1 ms batches
+static void generate(std::vector<std::shared_ptr<BlotGL::SampleRing>> rings, double rate,
+                     const std::atomic<bool> &stop)
+{
+    std::minstd_rand rng(1);
+    std::normal_distribution<float> noise(0.0f, 0.05f);
+    std::vector<float> batch(std::max<size_t>(size_t(rate / 1000), 1));
+    auto start = Clock::now();
+    uint64_t t = 0;
+    double walk = 0;
+    while (!stop) {
+        for (size_t s = 0; s < rings.size(); s++) {
+            for (size_t i = 0; i < batch.size(); i++) {
+                double x = double(t + i) / rate;
+                float v;
+                switch (s % 3) {
+                case 0:  v = float(std::sin(x * 2.0 + std::sin(x * 0.3) * 3.0)); break;
+                case 1:  v = std::fmod(x, 2.0) < 1.0 ? 0.5f : -0.5f; break;
+                default: walk = walk * 0.999999 + noise(rng) * 0.01; v = float(walk); break;
+                }
+                batch[i] = v + noise(rng);
+            }
+            rings[s]->write(batch.data(), batch.size());
+        }
+        t += batch.size();
+        std::this_thread::sleep_until(start + std::chrono::duration_cast<Clock::duration>(
+                                          std::chrono::duration<double>(t / rate)));
+    }
+}
+
+// interleaved native float32, one value per series per sample
+static void from_stdin(std::vector<std::shared_ptr<BlotGL::SampleRing>> rings,
+                       const std::atomic<bool> &stop)
+{
+    const size_t series = rings.size();
+    std::vector<float> in(series * 16384), out(16384);
+    size_t have = 0;    // bytes in `in`
+    while (!stop) {
+        // wake up now and then to see if the app quit
+        struct pollfd pfd{ .fd = STDIN_FILENO, .events = POLLIN };
+        if (poll(&pfd, 1, 100) == 0)
+            continue;
+        ssize_t n = read(STDIN_FILENO, reinterpret_cast<char*>(in.data()) + have,
+                         in.size() * sizeof(float) - have);
+        if (n <= 0)
+            return;
+        have += size_t(n);
+        size_t samples = have / (series * sizeof(float));
+        for (size_t s = 0; s < series; s++) {
+            for (size_t i = 0; i < samples; i++)
+                out[i] = in[i * series + s];
+            rings[s]->write(out.data(), samples);
+        }
+        size_t used = samples * series * sizeof(float);
+        std::memmove(in.data(), reinterpret_cast<char*>(in.data()) + used, have - used);
+        have -= used;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    bool use_stdin = argc > 1 && std::strcmp(argv[1], "-") == 0;
+    if (argc > 3 || (argc > 1 && !use_stdin && std::atof(argv[1]) <= 0)) {
+        fmt::println(stderr, "usage: {} [samples/s per series] | {} - <series>", argv[0], argv[0]);
+        fmt::println(stderr, "  plots made up signals, or interleaved float32 read from stdin");
+        return 1;
+    }
+    size_t series = use_stdin ? size_t(argc > 2 ? std::atoi(argv[2]) : 1) : 3;
+    double rate = use_stdin ? 0 : argc > 1 ? std::atof(argv[1]) : 2e6;
+
+    static constexpr std::array<std::array<float, 3>, 3> colors{{
+        { 1.0f, 0.8f, 0.2f }, { 0.3f, 0.7f, 1.0f }, { 0.4f, 1.0f, 0.4f },
+    }};
+    BlotGL::PlotOptions options{ .window = 1 << 22 };
+    std::vector<std::shared_ptr<BlotGL::SampleRing>> rings;
+    for (size_t s = 0; s < series; s++) {
+        auto &c = colors[s % colors.size()];
+        rings.push_back(std::make_shared<BlotGL::SampleRing>(1 << 22));
+        options.series.push_back({ rings.back(), c[0], c[1], c[2] });
+    }
+
+    BlotGL::App app;
+
+    app.push<BlotGL::PlotLayer>({}, options);
+
+    std::atomic<bool> stop{false};
+    auto start = Clock::now();
+    std::thread producer = use_stdin ? std::thread(from_stdin, rings, std::cref(stop))
+                                     : std::thread(generate, rings, rate, std::cref(stop));
+
+    int rc = app.run();
+
+    stop = true;
+    producer.join();
+
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    size_t written = 0, dropped = 0;
+    for (auto &ring : rings) {
+        written += ring->written();
+        dropped += ring->dropped();
+    }
+    fmt::println(stderr, "\nplot: {} series, {:.2f} M samples/s ingested, {} dropped",
+                 series, written / seconds / 1e6, dropped);
+    return rc;
+}
@@ -1,14 +1,5 @@
-#version 460 core
-
 // https://www.shadertoy.com/view/MtcGD7
 
-layout(location = 0) out vec4 fragColor;
-
-layout(location = 0) in vec2 v_TexCoord;
-
-layout(location = 0) uniform float iTime;
-layout(location = 1) uniform vec2 iResolution;
-
 vec3 rgb2hsv(vec3 c)
 {
     vec4 K = vec4(0.0, -1.0 / 3.0, 2.0 / 3.0, -1.0);
@@ -47,10 +38,8 @@ float fbm(vec2 n) {
     return total;
 }
 
-void main()
+void mainImage(out vec4 fragColor, in vec2 fragCoord)
 {
-	vec2 fragCoord = gl_FragCoord.xy;
-
     const vec3 c1 = vec3(0.5, 0.0, 0.1);
     const vec3 c2 = vec3(0.9, 0.1, 0.0);
     const vec3 c3 = vec3(0.2, 0.1, 0.7);
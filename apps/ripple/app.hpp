@@ -0,0 +1,24 @@
+#pragma once
+#include "blotgl_shader_layer.hpp"
+#include "buffer_a.glsl.hpp"
+#include "image.glsl.hpp"
+
+// a wave simulation in Buffer A, at half resolution, shaded by the image pass
+class AppLayer : public BlotGL::ShaderLayer {
+public:
+    explicit AppLayer()
+    : BlotGL::ShaderLayer({
+        .buffers = {
+            BlotGL::ShaderPass{
+                .embedded = &BlotGL::shaders::buffer_a,
+                .channels = { BlotGL::ShaderChannel::BufferA },
+                .scale = 0.5f,
+            },
+        },
+        .image = {
+            .embedded = &BlotGL::shaders::image,
+            .channels = { BlotGL::ShaderChannel::BufferA },
+        },
+    })
+    { }
+};
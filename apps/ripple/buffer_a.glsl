@@ -0,0 +1,30 @@
+// 2D wave equation: current height in x, previous height in y
+
+float hash(float n)
+{
+	return fract(sin(n) * 43758.5453);
+}
+
+void mainImage(out vec4 fragColor, in vec2 fragCoord)
+{
+	vec2 px = 1.0 / iResolution.xy;
+	vec2 uv = fragCoord * px;
+
+	vec2 c = texture(iChannel0, uv).xy;
+	float l = texture(iChannel0, uv - vec2(px.x, 0.0)).x;
+	float r = texture(iChannel0, uv + vec2(px.x, 0.0)).x;
+	float d = texture(iChannel0, uv - vec2(0.0, px.y)).x;
+	float u = texture(iChannel0, uv + vec2(0.0, px.y)).x;
+
+	float h = (l + r + u + d) * 0.5 - c.y;
+	h *= 0.985;
+
+	// a drop every few frames, somewhere new each time
+	int drop = iFrame / 10;
+	if (iFrame % 10 == 0) {
+		vec2 at = vec2(hash(float(drop)), hash(float(drop) + 17.0)) * iResolution.xy;
+		h += 2.0 * smoothstep(3.0, 0.0, length(fragCoord - at));
+	}
+
+	fragColor = vec4(h, c.x, 0.0, 1.0);
+}
@@ -0,0 +1,17 @@
+// shade the height field in Buffer A as water, lit from the top-left
+
+void mainImage(out vec4 fragColor, in vec2 fragCoord)
+{
+	vec2 uv = fragCoord / iResolution.xy;
+	vec2 px = 1.0 / iChannelResolution[0].xy;
+
+	float h = texture(iChannel0, uv).x;
+	float dx = texture(iChannel0, uv + vec2(px.x, 0.0)).x - texture(iChannel0, uv - vec2(px.x, 0.0)).x;
+	float dy = texture(iChannel0, uv + vec2(0.0, px.y)).x - texture(iChannel0, uv - vec2(0.0, px.y)).x;
+
+	vec3 n = normalize(vec3(-dx, -dy, 0.5));
+	float light = pow(max(dot(n, normalize(vec3(-1.0, 1.0, 1.0))), 0.0), 16.0);
+
+	vec3 water = vec3(0.0, 0.15, 0.35) * (0.6 + 0.4 * clamp(h, -1.0, 1.0));
+	fragColor = vec4(water + light * vec3(0.9, 0.95, 1.0), 1.0);
+}
@@ -1,20 +1,13 @@
-#version 460 core
-
 // https://www.shadertoy.com/view/wfSBzV
 
-layout(location = 0) out vec4 fragColor;
-
-layout(location = 0) in vec2 v_TexCoord;
-
-layout(location = 0) uniform float iTime;
-layout(location = 1) uniform vec2 iResolution;
-
 #define T iTime
 #define PI 3.141596
 #define TAU 6.283185
 #define S smoothstep
 #define s1(v) (sin(v)*.5+.5)
 const float EPSILON = 1e-6;
+// raymarching steps, fewer is faster and coarser
+layout(constant_id = 0) const int STEPS = 100;
 
 mat2 rotate(float a){
   float s = sin(a);
@@ -72,12 +65,8 @@ float sdFireBall(vec3 p){
 #define I fragCoord
 #define O fragColor
 
-void main()
+void mainImage(out vec4 fragColor, in vec2 fragCoord)
 {
-  vec3 iMouse = vec3(0);
-
-  vec2 fragCoord = gl_FragCoord.xy;
-
   vec2 R = iResolution.xy;
   vec2 uv = (I*2.-R)/R.y;
   vec2 m = (iMouse.xy*2.-R)/R * PI * 2.;
@@ -93,7 +82,7 @@ void main()
   float z = .1;
 
   vec3 p;
-  for(float i=0.;i<100.;i++){
+  for(int i=0;i<STEPS;i++){
     p = ro + rd * z;
 
     if(iMouse.z>0.){
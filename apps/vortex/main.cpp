@@ -8,10 +8,16 @@
 
 #include "app.hpp"
 
-int main() {
+int main(int argc, char *argv[]) {
+    int steps = argc > 1 ? std::atoi(argv[1]) : 100;
+    if (argc > 2 || steps <= 0) {
+        fmt::println(stderr, "usage: {} [raymarching steps, default 100]", argv[0]);
+        return 1;
+    }
+
     BlotGL::App app;
 
-    app.push<AppLayer>();
+    app.push<AppLayer>({}, steps);
 
     app.run();
 
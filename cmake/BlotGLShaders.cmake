@@ -0,0 +1,75 @@
+# Shaders built into the binaries, so nothing is read from the working
+# directory at runtime.  Each one is checked and compiled to SPIR-V by
+# glslangValidator at build time, and embedded along with its GLSL source
+# for drivers without GL_ARB_gl_spirv; see lib/blotgl_embedded_shader.hpp.
+# Without glslangValidator only the source is embedded, and it is compiled
+# when the app starts, like before.
+
+find_program(GLSLANG_VALIDATOR glslangValidator)
+if(GLSLANG_VALIDATOR)
+    message(STATUS "Compiling shaders to SPIR-V with ${GLSLANG_VALIDATOR}")
+else()
+    message(STATUS "glslangValidator not found, embedding shaders as GLSL source only")
+endif()
+
+set(BLOTGL_EMBED_SHADER_SCRIPT ${CMAKE_CURRENT_LIST_DIR}/EmbedShader.cmake)
+set(BLOTGL_SHADERTOY_PROLOGUE ${CMAKE_CURRENT_LIST_DIR}/../lib/shaders/shadertoy_prologue.glsl)
+set(BLOTGL_SHADERTOY_EPILOGUE ${CMAKE_CURRENT_LIST_DIR}/../lib/shaders/shadertoy_epilogue.glsl)
+
+# blotgl_embed_shader(<var> <name> <stage> <file> [SHADERTOY] [SOURCE_ONLY])
+#
+# Generates shaders/<name>.glsl.hpp in the current binary directory, which
+# defines BlotGL::shaders::<name> from <file>, and sets <var> to its path.
+# <stage> is glslangValidator's: vert, frag, ...  A SHADERTOY file is a
+# ShaderLayer pass, it is compiled wrapped in the prologue and epilogue that
+# ShaderLayer wraps its source in.  A SOURCE_ONLY file isn't compiled.
+function(blotgl_embed_shader VAR NAME STAGE FILE)
+    cmake_parse_arguments(ARG "SHADERTOY;SOURCE_ONLY" "" "" ${ARGN})
+    get_filename_component(FILE ${FILE} ABSOLUTE)
+    set(DIR ${CMAKE_CURRENT_BINARY_DIR}/shaders)
+    set(HEADER ${DIR}/${NAME}.glsl.hpp)
+    set(DEPENDS ${FILE} ${BLOTGL_EMBED_SHADER_SCRIPT})
+
+    set(SPIRV_ARGS)
+    if(GLSLANG_VALIDATOR AND NOT ARG_SOURCE_ONLY)
+        set(WHOLE ${DIR}/${NAME}.${STAGE})
+        set(SPIRV ${DIR}/${NAME}.spv)
+        set(WRAP_ARGS)
+        set(WRAP_DEPENDS)
+        if(ARG_SHADERTOY)
+            set(WRAP_ARGS -DPROLOGUE=${BLOTGL_SHADERTOY_PROLOGUE} -DEPILOGUE=${BLOTGL_SHADERTOY_EPILOGUE})
+            set(WRAP_DEPENDS ${BLOTGL_SHADERTOY_PROLOGUE} ${BLOTGL_SHADERTOY_EPILOGUE})
+        endif()
+        add_custom_command(
+            OUTPUT ${SPIRV}
+            COMMAND ${CMAKE_COMMAND} -DMODE=assemble -DINPUT=${FILE} -DOUTPUT=${WHOLE} ${WRAP_ARGS}
+                    -P ${BLOTGL_EMBED_SHADER_SCRIPT}
+            COMMAND ${GLSLANG_VALIDATOR} -G -S ${STAGE} -o ${SPIRV} ${WHOLE}
+            DEPENDS ${DEPENDS} ${WRAP_DEPENDS}
+            COMMENT "Compiling ${NAME} shader to SPIR-V"
+            VERBATIM
+        )
+        set(SPIRV_ARGS -DSPIRV=${SPIRV})
+        list(APPEND DEPENDS ${SPIRV})
+    endif()
+
+    add_custom_command(
+        OUTPUT ${HEADER}
+        COMMAND ${CMAKE_COMMAND} -DMODE=header -DNAME=${NAME} -DINPUT=${FILE} -DOUTPUT=${HEADER} ${SPIRV_ARGS}
+                -P ${BLOTGL_EMBED_SHADER_SCRIPT}
+        DEPENDS ${DEPENDS}
+        COMMENT "Embedding ${NAME} shader"
+        VERBATIM
+    )
+    set(${VAR} ${HEADER} PARENT_SCOPE)
+endfunction()
+
+# blotgl_target_shader(<target> <name> <stage> <file> [SHADERTOY] [SOURCE_ONLY])
+#
+# blotgl_embed_shader() for one target, which can then
+# #include "<name>.glsl.hpp"
+function(blotgl_target_shader TARGET NAME STAGE FILE)
+    blotgl_embed_shader(HEADER ${NAME} ${STAGE} ${FILE} ${ARGN})
+    target_sources(${TARGET} PRIVATE ${HEADER})
+    target_include_directories(${TARGET} PRIVATE ${CMAKE_CURRENT_BINARY_DIR}/shaders)
+endfunction()
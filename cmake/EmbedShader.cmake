@@ -0,0 +1,61 @@
+# Run by blotgl_embed_shader() as cmake -P, see BlotGLShaders.cmake
+#
+#   MODE=assemble   writes INPUT to OUTPUT, wrapped in PROLOGUE and EPILOGUE
+#                   if given, as ShaderLayer does at runtime
+#   MODE=header     writes a header to OUTPUT that defines NAME from INPUT's
+#                   source and, if given, the SPIR-V in SPIRV
+
+if(MODE STREQUAL "assemble")
+    set(TEXT "")
+    if(PROLOGUE)
+        file(READ ${PROLOGUE} TEXT)
+        # so compile errors point at lines of the file
+        string(APPEND TEXT "#line 1\n")
+    endif()
+    file(READ ${INPUT} BODY)
+    string(APPEND TEXT "${BODY}")
+    if(EPILOGUE)
+        file(READ ${EPILOGUE} EPILOGUE_TEXT)
+        string(APPEND TEXT "\n${EPILOGUE_TEXT}")
+    endif()
+    file(WRITE ${OUTPUT} "${TEXT}")
+
+elseif(MODE STREQUAL "header")
+    file(READ ${INPUT} SOURCE)
+    if(SOURCE MATCHES "\\)blotgl\"")
+        message(FATAL_ERROR "${INPUT} contains )blotgl\", which ends the raw string it is embedded in")
+    endif()
+
+    set(SPIRV_ARRAY "")
+    set(SPIRV_FIELDS "nullptr, 0")
+    if(SPIRV)
+        file(READ ${SPIRV} HEX HEX)
+        string(REGEX REPLACE "(..)" "0x\\1," BYTES "${HEX}")
+        # 16 to a line, cmake's regex has no {n}
+        set(LINE "0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,")
+        string(REGEX REPLACE "(${LINE})" "\\1\n    " BYTES "${BYTES}")
+        string(REGEX REPLACE "\n    $" "" BYTES "${BYTES}")
+        # SPIR-V is a stream of 32 bit words
+        set(SPIRV_ARRAY "alignas(4) inline constexpr unsigned char ${NAME}_spirv[] = {\n    ${BYTES}\n};\n\n")
+        set(SPIRV_FIELDS "${NAME}_spirv, sizeof(${NAME}_spirv)")
+    endif()
+
+    file(WRITE ${OUTPUT}
+"// generated from ${INPUT} by cmake/EmbedShader.cmake, do not edit
+#pragma once
+#include \"blotgl_embedded_shader.hpp\"
+
+namespace BlotGL::shaders {
+
+${SPIRV_ARRAY}inline constexpr EmbeddedShader ${NAME}{
+    \"${NAME}\",
+    R\"blotgl(${SOURCE})blotgl\",
+    ${SPIRV_FIELDS},
+};
+
+}
+")
+
+else()
+    message(FATAL_ERROR "EmbedShader.cmake: unknown MODE '${MODE}'")
+endif()
@@ -1,4 +1,4 @@
 #!/usr/bin/env bash
 
 sudo apt update
-sudo apt install clang cmake make pkg-config googletest libgtest-dev neovim gdb kitty-terminfo jq libgl-dev libglvnd-dev libegl1-mesa-dev libgbm-dev libgles2-mesa-dev libglib2.0-dev libglm-dev
+sudo apt install clang cmake make pkg-config googletest libgtest-dev neovim gdb kitty-terminfo jq libgl-dev libglvnd-dev libegl1-mesa-dev libgbm-dev libgles2-mesa-dev libglib2.0-dev libglm-dev glslang-tools
@@ -14,6 +14,7 @@
                 cmake
                 gnumake
                 pkg-config
+                glslang
 
                 # Libraries
                 libcxx
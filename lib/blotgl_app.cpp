@@ -4,9 +4,20 @@
 #include "blotgl_frame.hpp"
 #include "blotgl_terminal.hpp"
 #include "blotgl_braille.hpp"
+#include "blotgl_banded_readback.hpp"
+#include "blotgl_dirty_tiles.hpp"
+#include "blotgl_dmabuf.hpp"
 #include "blotgl_glerror.hpp"
-
+#include "blotgl_gl_state.hpp"
+#include "blotgl_gpu_timer.hpp"
+#include "blotgl_pixel_layer.hpp"
+#include "blotgl_shader.hpp"
+#include "blotgl_thread_pool.hpp"
+#include "blotgl_trace.hpp"
+
+#include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <thread>
 
 extern "C" {
@@ -17,10 +28,32 @@ extern "C" {
 
 namespace BlotGL {
 
-App::App()
+App::App(const Config &config)
+: m_config(config),
+  m_caps(config.probe ? probe_terminal(config.probe_timeout_ms, config.probe < 2) : TerminalCaps{}),
+  m_scaler(config.target_frame_ms, config.min_scale),
+  m_encoder({
+      .color_tolerance = config.color_tolerance,
+      .truecolor = m_caps.truecolor,
+      .synchronized = m_caps.sync_output,
+  }),
+  m_screen({
+      .distance = config.delta_distance,
+      .refresh = config.delta_refresh,
+      .scroll = config.scroll,
+      .scroll_columns = m_caps.lr_margins,
+  })
 {
+    select_isa(config.isa);
     update_dimensions();
 
+    // pixel layers only, nothing touches the GPU
+    if (!m_config.gl) {
+        if (!m_config.trace_path.empty())
+            m_tracer = std::make_unique<Tracer>(m_config.trace_path, m_config.trace_events, false);
+        return;
+    }
+
     m_fd = open("/dev/dri/renderD128", O_RDWR);
     if (m_fd < 0) {
         fprintf(stderr, "Failed to open render node (check permissions)\n");
@@ -63,9 +96,8 @@ App::App()
         EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
         EGL_NONE
     };
-    EGLConfig config;
     EGLint num_configs;
-    if (!eglChooseConfig(m_dpy, config_attribs, &config, 1, &num_configs) || num_configs == 0) {
+    if (!eglChooseConfig(m_dpy, config_attribs, &m_egl_config, 1, &num_configs) || num_configs == 0) {
         fprintf(stderr, "eglChooseConfig failed\n");
         eglTerminate(m_dpy);
         gbm_device_destroy(m_gbm);
@@ -81,12 +113,7 @@ App::App()
         throw std::runtime_error("eglBindAPI failed");
     }
 
-    static const EGLint ctx_attribs[] = {
-        EGL_CONTEXT_MAJOR_VERSION, 3,
-        EGL_CONTEXT_MINOR_VERSION, 3,
-        EGL_NONE
-    };
-    m_ctx = eglCreateContext(m_dpy, config, EGL_NO_CONTEXT, ctx_attribs);
+    m_ctx = create_context(EGL_NO_CONTEXT);
     if (!m_ctx) {
         fprintf(stderr, "eglCreateContext failed\n");
         eglTerminate(m_dpy);
@@ -103,17 +130,30 @@ App::App()
         close(m_fd);
         throw std::runtime_error("eglMakeCurrent failed");
     }
+    // nothing is bound in a new context, whatever an earlier one on this thread had
+    GLState::current().reset();
+    m_programs = std::make_unique<ProgramCache>();
+    Shader::share_programs(m_programs.get());
 
     GL(glGenFramebuffers(1, &m_fbo));
-    GL(glBindFramebuffer(GL_FRAMEBUFFER, m_fbo));
+    GLState::current().bind_framebuffer(GL_FRAMEBUFFER, m_fbo);
 
     GL(glGenRenderbuffers(1, &m_rb));
-    GL(glBindRenderbuffer(GL_RENDERBUFFER, m_rb));
-    GL(glRenderbufferStorage(GL_RENDERBUFFER, GL_RGB8, m_width, m_height));
+    allocate_output();
     GL(glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_rb));
 
+    // some drivers import the buffer but can't render into it
+    if (m_dmabuf && glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        m_dmabuf.reset();
+        m_config.zero_copy = false;
+        GL(glRenderbufferStorage(GL_RENDERBUFFER, GL_RGB8, m_width, m_height));
+    }
+    if (m_config.zero_copy && !m_dmabuf)
+        fmt::println(stderr, "zero-copy readback not available, using glReadPixels");
+
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
         fprintf(stderr, "Framebuffer incomplete\n");
+        m_dmabuf.reset();
         glDeleteRenderbuffers(1, &m_rb);
         glDeleteFramebuffers(1, &m_fbo);
         eglMakeCurrent(m_dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
@@ -124,7 +164,31 @@ App::App()
         throw std::runtime_error("Framebuffer incomplete");
     }
 
+    if (scaled())
+        allocate_render_target();
+
+    m_gpu_timer = std::make_unique<GpuTimer>();
+
+    if (!m_config.trace_path.empty())
+        m_tracer = std::make_unique<Tracer>(m_config.trace_path, m_config.trace_events);
+
+    if (m_config.dirty_tiles) {
+        const auto [glyph_cols, glyph_rows] = cell_geometry(m_config.encoding);
+        m_dirty_tiles = std::make_unique<DirtyTiles>(TILE_COLS * glyph_cols, TILE_ROWS * glyph_rows);
+    }
+
+    // only used while reading back with glReadPixels, zero-copy may be lost on a resize
+    if (m_config.bands)
+        m_banded = std::make_unique<BandedReadback>();
+
     if (blotgl_drain_glerrors()) {
+        m_tracer.reset();
+        m_dirty_tiles.reset();
+        m_banded.reset();
+        m_gpu_timer.reset();
+        m_dmabuf.reset();
+        glDeleteRenderbuffers(1, &m_render_rb);
+        glDeleteFramebuffers(1, &m_render_fbo);
         glDeleteRenderbuffers(1, &m_rb);
         glDeleteFramebuffers(1, &m_fbo);
         eglMakeCurrent(m_dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
@@ -137,8 +201,18 @@ App::App()
 }
 
 App::~App() {
+    m_tracer.reset();
+    if (!gl())
+        return;
+    Shader::share_programs(nullptr);
+    m_dirty_tiles.reset();
+    m_banded.reset();
+    m_gpu_timer.reset();
+    m_dmabuf.reset();
+    glDeleteRenderbuffers(1, &m_render_rb);
+    GLState::current().delete_framebuffers(1, &m_render_fbo);
     glDeleteRenderbuffers(1, &m_rb);
-    glDeleteFramebuffers(1, &m_fbo);
+    GLState::current().delete_framebuffers(1, &m_fbo);
     eglMakeCurrent(m_dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
     eglDestroyContext(m_dpy, m_ctx);
     eglTerminate(m_dpy);
@@ -146,37 +220,145 @@ App::~App() {
     close(m_fd);
 }
 
+EGLContext App::create_context(EGLContext share) const
+{
+    static const EGLint ctx_attribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_NONE
+    };
+    EGLContext ctx = eglCreateContext(m_dpy, m_egl_config, share, ctx_attribs);
+    return ctx ? ctx : EGL_NO_CONTEXT;
+}
+
 bool App::update_dimensions()
 {
-    unsigned cols, rows;
+    const auto [glyph_cols, glyph_rows] = cell_geometry(m_config.encoding);
+
+    unsigned cols{}, rows{};
     try {
         auto ws = linux_terminal_winsize();
-        cols = (ws.ws_col-1) * BRAILLE_GLYPH_COLS;
-        rows = (ws.ws_row-1) * BRAILLE_GLYPH_ROWS;
-    } catch (std::exception ex) {}
+        cols = (ws.ws_col-1) * glyph_cols;
+        rows = (ws.ws_row-1) * glyph_rows;
+
+        // the probe's CSI 14 t answer only holds for the size it was asked at,
+        // but a cell's shape outlives a resize
+        unsigned xpixel = ws.ws_xpixel, ypixel = ws.ws_ypixel;
+        if (!m_width && !xpixel) {
+            xpixel = m_caps.pixel_width;
+            ypixel = m_caps.pixel_height;
+        }
+        if (xpixel && ypixel && ws.ws_col && ws.ws_row)
+            m_pixel_aspect = float(xpixel) * ws.ws_row * glyph_rows
+                           / (float(ypixel) * ws.ws_col * glyph_cols);
+    } catch (const std::exception &ex) {}
+
+    // smallest size is 100x25 characters, and must be multiple of glyph size
+    cols = std::max<unsigned>(100 * glyph_cols, multiple_of<unsigned>(cols, glyph_cols));
+    rows = std::max<unsigned>(25 * glyph_rows, multiple_of<unsigned>(rows, glyph_rows));
+
+    // layers render at a fraction of that, and get resampled on the GPU
+    float scale = m_scaler.scale();
+    unsigned render_cols = std::max(1u, unsigned(cols * scale));
+    unsigned render_rows = std::max(1u, unsigned(rows * scale));
+
+    if (cols == m_width && rows == m_height
+            && render_cols == m_render_width && render_rows == m_render_height)
+        return false;
 
-    // smallest size is 200x100, and must be multiple of braille size
-    cols = std::max(200u, multiple_of<unsigned>(cols, BRAILLE_GLYPH_COLS));
-    rows = std::max(100u, multiple_of<unsigned>(rows, BRAILLE_GLYPH_ROWS));
+    const bool resized = cols != m_width || rows != m_height;
+    m_width = cols;
+    m_height = rows;
+    m_render_width = render_cols;
+    m_render_height = render_rows;
 
-    if (cols == m_width && rows == m_height)
-        return false;
+    // before the GL context exists, the constructor allocates storage
+    if (!m_fbo)
+        return true;
 
-    glDeleteRenderbuffers(1, &m_rb);
+    // a new scale only changes what the layers render into
+    if (resized)
+        allocate_output();
 
-    GL(glGenRenderbuffers(1, &m_rb));
+    if (scaled())
+        allocate_render_target();
+
+    return true;
+}
+
+void App::allocate_output()
+{
+    GLState::current().bind_framebuffer(GL_FRAMEBUFFER, m_fbo);
     GL(glBindRenderbuffer(GL_RENDERBUFFER, m_rb));
+
+    // with or without zero-copy, the cells sit elsewhere in the arena
+    if (m_dirty_tiles)
+        m_dirty_tiles->invalidate();
+
+    // the new buffer takes over the renderbuffer before the old one goes away
+    if (m_config.zero_copy) {
+        auto dmabuf = DmaBufTarget::create(m_gbm, m_dpy, m_width, m_height);
+        bool had = bool(m_dmabuf);
+        m_dmabuf = std::move(dmabuf);
+        if (m_dmabuf)
+            return;
+        if (had)
+            fmt::println(stderr, "zero-copy readback lost on resize, using glReadPixels");
+    }
+
     GL(glRenderbufferStorage(GL_RENDERBUFFER, GL_RGB8, m_width, m_height));
-    GL(glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_rb));
+}
 
-    m_width = cols;
-    m_height = rows;
-    return true;
+void App::allocate_render_target()
+{
+    if (!m_render_fbo) {
+        GL(glGenFramebuffers(1, &m_render_fbo));
+        GL(glGenRenderbuffers(1, &m_render_rb));
+    }
+
+    GLState::current().bind_framebuffer(GL_FRAMEBUFFER, m_render_fbo);
+    GL(glBindRenderbuffer(GL_RENDERBUFFER, m_render_rb));
+    GL(glRenderbufferStorage(GL_RENDERBUFFER, GL_RGB8, m_render_width, m_render_height));
+    GL(glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_render_rb));
 }
 
+thread_local Viewport App::g_viewport;
+
 std::pair<float,float> App::get_dimensions() const
 {
-    return { m_width, m_height };
+    return { g_viewport.width, g_viewport.height };
+}
+
+Viewport App::resolve_view(const View &view, unsigned render_width, unsigned render_height) const
+{
+    const auto [glyph_cols, glyph_rows] = cell_geometry(m_config.encoding);
+
+    // snap to whole glyphs of the output
+    auto snap = [](float fraction, unsigned size, unsigned glyph) {
+        fraction = std::clamp(fraction, 0.0f, 1.0f);
+        return unsigned(std::lround(fraction * size / glyph)) * glyph;
+    };
+    unsigned left   = snap(view.x, m_width, glyph_cols);
+    unsigned right  = snap(view.x + view.width, m_width, glyph_cols);
+    unsigned top    = snap(view.y, m_height, glyph_rows);
+    unsigned bottom = snap(view.y + view.height, m_height, glyph_rows);
+
+    // flip to GL's bottom-left origin, and scale into the render target
+    float sx = float(render_width) / m_width;
+    float sy = float(render_height) / m_height;
+    int x0 = std::lround(left * sx);
+    int x1 = std::lround(right * sx);
+    int y0 = std::lround((m_height - bottom) * sy);
+    int y1 = std::lround((m_height - top) * sy);
+
+    return { x0, y0, unsigned(std::max(0, x1 - x0)), unsigned(std::max(0, y1 - y0)) };
+}
+
+void App::bind_viewport(const Viewport &viewport)
+{
+    g_viewport = viewport;
+    GLState::current().viewport(viewport.x, viewport.y, viewport.width, viewport.height);
+    GL(glScissor(viewport.x, viewport.y, viewport.width, viewport.height));
 }
 
 // TODO: should do proper event handling
@@ -201,6 +383,9 @@ void App::sig_handler(int signo) {
 
 int App::run()
 {
+    if (!m_config.export_path.empty())
+        return run_export();
+
     auto start_time = std::chrono::steady_clock::now();
     auto last_time = start_time;
     double target_delta = 1.0 / 120.0;  // Cap at 120 FPS
@@ -220,7 +405,12 @@ int App::run()
         auto delta = std::chrono::duration<double>(frame_end - start_time).count();
         auto avgsec = frames ? delta / frames : 0.0;
         auto fps = avgsec ? 1.0 / avgsec : 0.0;
-        fmt::print("{}x{} FPS: {:.2f}\r", m_width, m_height, fps);
+        fmt::print("{}x{} scale: {:.2f} {:.1f} KiB/frame{}{} {} FPS: {:.2f}\r",
+                   m_width, m_height, m_scaler.scale(), m_frame_bytes / 1024.0,
+                   m_dirty_tiles ? fmt::format(" tiles: {:.0f}%", m_tiles_read * 100) : "",
+                   gl() ? fmt::format(" gl: {}/{}", m_gl_calls.issued,
+                                      m_gl_calls.issued + m_gl_calls.skipped) : "",
+                   isa_name(active_isa()), fps);
         std::flush(std::cout);
 
         if (g_interrupted)
@@ -246,27 +436,445 @@ int App::run()
 
 void App::step(float timestamp)
 {
-    update_dimensions();
+    Tracer *tracer = m_tracer.get();
+    if (tracer)
+        tracer->begin_frame();
+    TraceSpan frame_span(tracer, "frame");
+
+    const bool scaling = gl() && m_scaler.enabled();
+    if (scaling) {
+        if (auto ms = m_gpu_timer->poll())
+            m_scaler.update(*ms);
+    }
+
+    if (update_dimensions())
+        m_full_redraw = true;
+
+    if (gl()) {
+        GLState::current().bind_framebuffer(GL_FRAMEBUFFER, scaled() ? m_render_fbo : m_fbo);
+
+        if (scaling)
+            m_gpu_timer->begin();
+
+        // pixel layers change the whole of their views every frame
+        bool whole = m_full_redraw || !m_pixel_layers.empty();
+        m_partial = draw_layers(m_layers, m_render_width, m_render_height, timestamp, tracer,
+                                whole ? nullptr : &m_damage);
+        if (m_partial)
+            damage_to_cells();
+
+        if (scaling)
+            m_gpu_timer->end();
+
+        if (scaled()) {
+            GpuTraceSpan gpu_span(tracer, "blit");
+            // resample to the glyph grid
+            GLState &gl = GLState::current();
+            gl.bind_framebuffer(GL_READ_FRAMEBUFFER, m_render_fbo);
+            gl.bind_framebuffer(GL_DRAW_FRAMEBUFFER, m_fbo);
+            GL(glBlitFramebuffer(0, 0, m_render_width, m_render_height,
+                                 0, 0, m_width, m_height,
+                                 GL_COLOR_BUFFER_BIT, GL_LINEAR));
+            gl.bind_framebuffer(GL_FRAMEBUFFER, m_fbo);
+        }
+    }
+
+    if (!m_pixel_layers.empty()) {
+        TraceSpan span(tracer, "update");
+        update_pixel_layers(m_pixel_layers, timestamp);
+    }
+
+    dispatch_cell_encoding(m_config.encoding, [this]<typename CELL>() {
+        present<CELL>();
+    });
+    m_full_redraw = false;
+    m_gl_calls = GLState::current().take_counts();
+}
+
+// clear the bound framebuffer and draw the layers into it; given damage, and
+// with every layer tracking its own, only what they report is cleared and
+// redrawn, damage is set to where that is, and the return is true
+bool App::draw_layers(const std::vector<std::unique_ptr<Layer>> &layers,
+                      unsigned render_width, unsigned render_height, float timestamp,
+                      Tracer *tracer, std::vector<Viewport> *damage) const
+{
+    GpuTraceSpan gpu_span(tracer, "layers");
+
+    bool partial = damage && !layers.empty()
+                && std::all_of(layers.begin(), layers.end(),
+                               [](const auto &layer) { return layer->tracks_damage(); });
+
+    GL(glDisable(GL_SCISSOR_TEST));
+    GLState::current().viewport(0, 0, render_width, render_height);
+    GLState::current().clear_color(0.0f, 0.0f, 0.0f, 1.0f);
+    if (!partial)
+        GL(glClear(GL_COLOR_BUFFER_BIT));
+
+    // every layer draws into its own part of the one render target, clipped to it
+    GL(glEnable(GL_SCISSOR_TEST));
+
+    {
+        TraceSpan span(tracer, "update");
+        for (const auto &layer : layers) {
+            layer->clear_damage();
+            bind_viewport(resolve_view(layer->view(), render_width, render_height));
+            layer->on_update(*this, timestamp);
+        }
+    }
+
+    if (partial) {
+        // what the layers report, moved into the render target and clipped to their views
+        damage->clear();
+        for (const auto &layer : layers) {
+            Viewport view = resolve_view(layer->view(), render_width, render_height);
+            for (const Viewport &rect : layer->damaged()) {
+                Viewport moved{ view.x + rect.x, view.y + rect.y, rect.width, rect.height };
+                Viewport clipped = intersect(moved, view);
+                if (clipped.width && clipped.height)
+                    damage->push_back(clipped);
+            }
+        }
+        // layers render once per rect, overlapping ones would draw pixels twice
+        merge_rects(*damage);
+        for (const Viewport &rect : *damage) {
+            GL(glScissor(rect.x, rect.y, rect.width, rect.height));
+            GL(glClear(GL_COLOR_BUFFER_BIT));
+        }
+    }
+
+    {
+        TraceSpan span(tracer, "render");
+        for (const auto &layer : layers) {
+            Viewport view = resolve_view(layer->view(), render_width, render_height);
+            if (!partial) {
+                bind_viewport(view);
+                layer->on_render();
+                continue;
+            }
+            // once for each damaged part of the view, scissored to it
+            for (const Viewport &rect : *damage) {
+                Viewport clipped = intersect(rect, view);
+                if (!clipped.width || !clipped.height)
+                    continue;
+                bind_viewport(view);
+                GL(glScissor(clipped.x, clipped.y, clipped.width, clipped.height));
+                layer->on_render();
+            }
+        }
+    }
 
-    GL(glViewport(0, 0, m_width, m_height));
-    GL(glClearColor(0.0f, 0.0f, 0.0f, 1.0f));
-    GL(glClear(GL_COLOR_BUFFER_BIT));
+    GL(glDisable(GL_SCISSOR_TEST));
+    return partial;
+}
 
-    Frame<3> frame(m_width, m_height);
+void App::add_pixel_layer(std::unique_ptr<PixelLayer> layer)
+{
+    if (!m_pool)
+        m_pool = std::make_unique<ThreadPool>(m_config.threads);
+    m_pixel_layers.push_back(std::move(layer));
+}
 
-    for (const auto &layer : m_layers)
+// pixel layers work at the output's resolution, get_viewport() is in its pixels
+void App::update_pixel_layers(const std::vector<std::unique_ptr<PixelLayer>> &layers, float timestamp) const
+{
+    for (const auto &layer : layers) {
+        g_viewport = resolve_view(layer->view(), m_width, m_height);
         layer->on_update(*this, timestamp);
+    }
+}
 
-    for (const auto &layer : m_layers)
-        layer->on_render();
+// draw the pixel layers' part of output rows begin..end, counted from the top,
+// into a full-size RGB image with GL's bottom row first; on the pool if given
+void App::render_pixel_layers(const std::vector<std::unique_ptr<PixelLayer>> &layers, uint8_t *pixels,
+                              unsigned begin_row, unsigned end_row, ThreadPool *pool) const
+{
+    const ptrdiff_t row_bytes = ptrdiff_t(m_width) * 3;
+
+    for (const auto &layer : layers) {
+        Viewport viewport = resolve_view(layer->view(), m_width, m_height);
+        unsigned top = m_height - (viewport.y + viewport.height);
+        unsigned begin = std::max(begin_row, top);
+        unsigned end = std::min(end_row, top + viewport.height);
+        if (!viewport.width || begin >= end)
+            continue;
+
+        // the view's top row is the highest in GL's image, rows below it come before it
+        const PixelView view{
+            .top = pixels + ptrdiff_t(m_height - 1 - top) * row_bytes + ptrdiff_t(viewport.x) * 3,
+            .stride = -row_bytes,
+            .width = viewport.width,
+            .height = viewport.height,
+        };
+        begin -= top;
+        end -= top;
+
+        PixelLayer &pixel_layer = *layer;
+        if (!pool) {
+            pixel_layer.render_rows(view, begin, end);
+            continue;
+        }
+        pool->parallel_for(end - begin, 0, [&pixel_layer, &view, begin](size_t first, size_t last) {
+            pixel_layer.render_rows(view, begin + unsigned(first), begin + unsigned(last));
+        });
+    }
+}
+
+// the damage in output cells: scaled up when the render target is smaller, a
+// pixel more each way for the filtering, then out to whole cells, top-down
+void App::damage_to_cells()
+{
+    const auto [glyph_cols, glyph_rows] = cell_geometry(m_config.encoding);
+    float sx = float(m_width) / m_render_width;
+    float sy = float(m_height) / m_render_height;
+    int margin = scaled() ? 1 : 0;
+
+    m_damage_cells.clear();
+    for (const Viewport &rect : m_damage) {
+        int x0 = std::max(0, int(std::floor(rect.x * sx)) - margin);
+        int y0 = std::max(0, int(std::floor(rect.y * sy)) - margin);
+        int x1 = std::min(int(m_width), int(std::ceil((rect.x + rect.width) * sx)) + margin);
+        int y1 = std::min(int(m_height), int(std::ceil((rect.y + rect.height) * sy)) + margin);
+        if (x1 <= x0 || y1 <= y0)
+            continue;
+
+        unsigned left = x0 / glyph_cols;
+        unsigned right = div_round_up(unsigned(x1), glyph_cols);
+        unsigned top = (m_height - y1) / glyph_rows;
+        unsigned bottom = div_round_up(m_height - y0, glyph_rows);
+        m_damage_cells.push_back({ left, top, right - left, bottom - top });
+    }
+}
 
-    GL(glFinish());
-    GL(glReadPixels(0, 0, m_width, m_height, GL_RGB, GL_UNSIGNED_BYTE, frame.pixels()));
+template <typename CELL>
+void App::present()
+{
+    Tracer *tracer = m_tracer.get();
+    // the GPU doesn't see what pixel layers draw, so can't tell what changed
+    const bool pixels = !m_pixel_layers.empty();
+
+    DirtyTiles *tiles = pixels ? nullptr : m_dirty_tiles.get();
+    if (pixels && m_dirty_tiles) {
+        // this frame's cells are converted whole, but never compared
+        m_dirty_tiles->invalidate();
+    }
+    if (tiles) {
+        TraceSpan span(tracer, "detect");
+        GpuTraceSpan gpu_span(tracer, "detect");
+        tiles->detect(m_fbo, m_width, m_height);
+        m_tiles_read = float(tiles->dirty_count()) / std::max<size_t>(tiles->count(), 1);
+    }
 
-    frame.pixels_to_braille(true);
-    std::stringstream ss;
-    frame.braille_to_stream(ss);
-    std::puts(ss.str().c_str());
+    if (gl()) {
+        TraceSpan span(tracer, "finish");
+        GL(glFinish());
+    }
+
+    // cells of clean tiles keep what the last frame converted, the arena holds them in place
+    auto convert = [this, tiles](auto &frame) {
+        if (m_partial) {
+            frame.pixels_to_cells(true, m_damage_cells);
+            return;
+        }
+        if (!tiles) {
+            frame.pixels_to_cells(true);
+            return;
+        }
+        frame.pixels_to_cells(true, tiles->tile_width() / CELL::COLS, tiles->tile_height() / CELL::ROWS,
+                              [tiles](unsigned column, unsigned row) { return tiles->dirty(column, row); });
+    };
+
+    // zero-copy: convert straight out of the buffer the GPU rendered into
+    if (m_dmabuf && !pixels) {
+        Frame<CELL,4> frame(m_width, m_height, m_arena, m_dmabuf->pixels(), m_dmabuf->stride());
+        {
+            TraceSpan span(tracer, "convert");
+            m_dmabuf->begin_cpu_access();
+            convert(frame);
+            m_dmabuf->end_cpu_access();
+        }
+        encode_and_write(frame);
+        return;
+    }
+
+    Frame<CELL> frame(m_width, m_height, m_arena);
+
+    if (m_banded && !m_partial && !tiles) {
+        present_banded(frame);
+        return;
+    }
+
+    if (!gl()) {
+        // nothing rendered, pixel layers draw on black
+        frame.pixel_reset();
+    }
+    else {
+        TraceSpan span(tracer, "readback");
+        GpuTraceSpan gpu_span(tracer, "readback");
+        if (m_partial) {
+            std::vector<Viewport> rects;
+            for (const CellRect &cells : m_damage_cells) {
+                unsigned x = cells.x * CELL::COLS;
+                unsigned top = cells.y * CELL::ROWS;
+                unsigned right = std::min<unsigned>((cells.x + cells.width) * CELL::COLS, m_width);
+                unsigned bottom = std::min<unsigned>((cells.y + cells.height) * CELL::ROWS, m_height);
+                rects.push_back({ int(x), int(m_height - bottom), right - x, bottom - top });
+            }
+            read_rects(rects, frame.pixels());
+        }
+        else if (tiles)
+            read_dirty_tiles(*tiles, frame.pixels());
+        else
+            GL(glReadPixels(0, 0, m_width, m_height, GL_RGB, GL_UNSIGNED_BYTE, frame.pixels()));
+    }
+
+    if (pixels) {
+        TraceSpan span(tracer, "pixels");
+        render_pixel_layers(m_pixel_layers, frame.pixels(), 0, m_height, m_pool.get());
+    }
+
+    {
+        TraceSpan span(tracer, "convert");
+        convert(frame);
+    }
+
+    encode_and_write(frame);
+}
+
+// read back, convert, encode and write a band of rows at a time from the top,
+// each band's conversion and write overlapping the readback of the next
+template <typename FRAME>
+void App::present_banded(FRAME &frame)
+{
+    Tracer *tracer = m_tracer.get();
+    constexpr unsigned ROWS = FRAME::Cell::ROWS;
+
+    unsigned band_rows = m_config.band_rows ? m_config.band_rows * ROWS
+                                            : BandedReadback::auto_band_rows(m_width, ROWS);
+    m_banded->resize(m_width, m_height, band_rows);
+    Screen *screen = m_config.delta ? &m_screen : nullptr;
+
+    if (screen)
+        frame.begin_encode(m_encoder, *screen);
+    else
+        frame.begin_encode(m_encoder, !m_caps.sync_output);
+
+    size_t written = 0;
+    m_banded->read(0);
+    for (unsigned band = 0; band < m_banded->bands(); band++) {
+        if (band + 1 < m_banded->bands())
+            m_banded->read(band + 1);
+
+        {
+            TraceSpan span(tracer, "readback");
+            m_banded->fetch(band, frame.pixels());
+        }
+        if (!m_pixel_layers.empty()) {
+            TraceSpan span(tracer, "pixels");
+            render_pixel_layers(m_pixel_layers, frame.pixels(), m_banded->band_top(band),
+                                m_banded->band_bottom(band), m_pool.get());
+        }
+
+        unsigned begin = m_banded->band_top(band) / ROWS;
+        unsigned end = div_round_up(m_banded->band_bottom(band), ROWS);
+        {
+            TraceSpan span(tracer, "convert");
+            frame.pixels_to_cells(true, begin, end);
+        }
+        {
+            TraceSpan span(tracer, "encode");
+            frame.encode_rows(m_encoder, begin, end, screen);
+        }
+        // the terminal can take these rows while the next band is read
+        if (band + 1 < m_banded->bands()) {
+            write_output(written);
+            written = m_frame_bytes;
+            m_encoder.drain();
+        }
+    }
+    frame.end_encode(m_encoder);
+
+    write_output(written);
+}
+
+// read back runs of dirty tiles
+void App::read_dirty_tiles(const DirtyTiles &tiles, uint8_t *pixels) const
+{
+    const unsigned tw = tiles.tile_width(), th = tiles.tile_height();
+    std::vector<Viewport> rects;
+
+    for (unsigned row = 0; row < tiles.rows(); row++) {
+        // tile rows count from the top, GL from the bottom
+        unsigned top = row * th;
+        unsigned bottom = std::min(top + th, m_height);
+
+        for (unsigned column = 0; column < tiles.columns(); ) {
+            if (!tiles.dirty(column, row)) {
+                column ++;
+                continue;
+            }
+            unsigned first = column;
+            while (column < tiles.columns() && tiles.dirty(column, row))
+                column ++;
+
+            unsigned x = first * tw;
+            unsigned width = std::min(column * tw, m_width) - x;
+            rects.push_back({ int(x), int(m_height - bottom), width, bottom - top });
+        }
+    }
+
+    read_rects(rects, pixels);
+}
+
+// read back parts of the output, each to where it goes in a full-size RGB image
+void App::read_rects(const std::vector<Viewport> &rects, uint8_t *pixels) const
+{
+    GL(glPixelStorei(GL_PACK_ALIGNMENT, 1));
+    GL(glPixelStorei(GL_PACK_ROW_LENGTH, m_width));
+
+    for (const Viewport &rect : rects) {
+        uint8_t *dst = pixels + (size_t(rect.y) * m_width + rect.x) * 3;
+        GL(glReadPixels(rect.x, rect.y, rect.width, rect.height, GL_RGB, GL_UNSIGNED_BYTE, dst));
+    }
+
+    GL(glPixelStorei(GL_PACK_ROW_LENGTH, 0));
+    GL(glPixelStorei(GL_PACK_ALIGNMENT, 4));
+}
+
+// shared by both readback paths, once the cells are ready
+template <typename FRAME>
+void App::encode_and_write(FRAME &frame)
+{
+    Tracer *tracer = m_tracer.get();
+
+    // nothing changed, nothing to send
+    if (m_partial && m_damage_cells.empty()) {
+        m_frame_bytes = 0;
+        return;
+    }
+
+    {
+        TraceSpan span(tracer, "encode");
+        // with synchronized output the terminal never shows a half drawn frame, so
+        // overwriting in place is flicker free and there is no need to clear
+        if (m_config.delta)
+            frame.encode(m_encoder, m_screen, m_partial ? &m_damage_cells : nullptr);
+        else if (m_partial)
+            frame.encode(m_encoder, m_damage_cells);
+        else
+            frame.encode(m_encoder, !m_caps.sync_output);
+    }
+
+    write_output();
+}
+
+// written is what of this frame went out already
+void App::write_output(size_t written)
+{
+    TraceSpan span(m_tracer.get(), "write");
+    const auto &out = m_encoder.buffer();
+    std::fwrite(out.data(), 1, out.size(), stdout);
+    std::fflush(stdout);
+    m_frame_bytes = written + out.size();
 }
 
 }
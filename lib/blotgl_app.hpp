@@ -7,6 +7,9 @@
 #include <fmt/core.h>
 #include <fmt/ostream.h>
 #include <stdexcept>
+#include <memory>
+#include <vector>
+#include <functional>
 
 extern "C" {
 #include <EGL/egl.h>
@@ -18,6 +21,15 @@ extern "C" {
 #include <unistd.h>
 };
 
+#include "blotgl_config.hpp"
+#include "blotgl_gl_state.hpp"
+#include "blotgl_probe.hpp"
+#include "blotgl_resolution.hpp"
+#include "blotgl_encoder.hpp"
+#include "blotgl_screen.hpp"
+#include "blotgl_arena.hpp"
+#include "blotgl_view.hpp"
+
 namespace BlotGL {
 
 struct Event {
@@ -25,26 +37,89 @@ struct Event {
 };
 
 class App;
+class BandedReadback;
+class DirtyTiles;
+class DmaBufTarget;
+class GpuTimer;
+class PixelLayer;
+class ProgramCache;
+class ThreadPool;
+class Tracer;
 
 class Layer {
+protected:
+    View m_view;
+    bool m_tracks_damage{false};
+    std::vector<Viewport> m_damage;
+
+    // for layers that know what they change: call track_damage() in the
+    // constructor, draw nothing in on_update(), and report there the parts of
+    // the view that change with damage(), in view pixels from the bottom-left;
+    // on_render() is then called once for every damaged rect of the frame it
+    // overlaps (theirs and other layers', merged), with a scissor set to that
+    // rect, so it must draw the same each time and leave state to on_update()
+    void track_damage() { m_tracks_damage = true; }
+    void damage(const Viewport &rect) { m_damage.push_back(rect); }
+
 public:
     explicit Layer() = default;
     virtual ~Layer() = default;
     virtual void on_event(Event &event) {}
+    // an export makes an instance per worker, and each only sees some of the
+    // frames (in order), so what a layer shows has to follow from the timestamp
+    // alone; one that carries state from frame to frame has to catch up to it
     virtual void on_update(const BlotGL::App &app, float timestamp) {}
     virtual void on_render() {}
+    // false for layers that can't have an instance per export worker, e.g. ones
+    // that consume a shared queue; an export with one of them fails
+    virtual bool exportable() const { return true; }
+
+    const View& view() const { return m_view; }
+    void set_view(const View &view) { m_view = view; }
+
+    bool tracks_damage() const { return m_tracks_damage; }
+    const std::vector<Viewport>& damaged() const { return m_damage; }
+    void clear_damage() { m_damage.clear(); }
 };
 
 class App final {
 protected:
-    unsigned m_width{};
+    Config m_config;
+    TerminalCaps m_caps;
+    unsigned m_width{};          // output size, a whole number of glyphs
     unsigned m_height{};
+    unsigned m_render_width{};   // size the layers render at, m_width/m_height scaled
+    unsigned m_render_height{};
+    float m_pixel_aspect{1.0f};  // width over height of an output pixel on screen
     int m_fd{-1};
     struct gbm_device *m_gbm{nullptr};
     EGLDisplay m_dpy{EGL_NO_DISPLAY};
+    EGLConfig m_egl_config{};
     EGLContext m_ctx{EGL_NO_CONTEXT};
-    GLuint m_fbo{0};
+    GLuint m_fbo{0};             // output, read back to the CPU
     GLuint m_rb{0};
+    std::unique_ptr<DmaBufTarget> m_dmabuf;  // m_rb's storage, when zero-copy works
+    GLuint m_render_fbo{0};      // scaled render target, blitted into m_fbo
+    GLuint m_render_rb{0};
+
+    ResolutionScaler m_scaler;
+    FrameArena m_arena;
+    Encoder m_encoder;
+    Screen m_screen;
+    size_t m_frame_bytes{};
+    GLCallCounts m_gl_calls;    // made through GLState last frame, and left out
+    std::unique_ptr<GpuTimer> m_gpu_timer;
+    std::unique_ptr<Tracer> m_tracer;
+    std::unique_ptr<DirtyTiles> m_dirty_tiles;
+    std::unique_ptr<BandedReadback> m_banded;
+    float m_tiles_read{1};      // fraction of the output read back last frame
+    bool m_full_redraw{true};   // the terminal and render target need everything
+    bool m_partial{false};      // this frame only redrew m_damage
+    std::vector<Viewport> m_damage;         // render target pixels
+    std::vector<CellRect> m_damage_cells;   // the same, grown to whole cells of the output
+
+    static constexpr unsigned TILE_COLS = 16;   // dirty tile size, in cells
+    static constexpr unsigned TILE_ROWS = 8;
 
     App(const App&) = delete;
     App(App&&) = delete;
@@ -52,9 +127,55 @@ protected:
     App& operator=(App&&) = delete;
 
     bool m_running = false;
+    // programs m_ctx and the export workers' contexts share, outliving the layers
+    std::unique_ptr<ProgramCache> m_programs;
     std::vector<std::unique_ptr<Layer>> m_layers;
-
+    // drawn on the CPU, over what the GL layers rendered; see blotgl_pixel_layer.hpp
+    std::vector<std::unique_ptr<PixelLayer>> m_pixel_layers;
+    std::unique_ptr<ThreadPool> m_pool;     // pixel layers' rows are split across it
+
+    // how to make more of each pushed layer, for contexts other than m_ctx
+    struct LayerFactory {
+        std::function<std::unique_ptr<Layer>()> create;
+        View view;
+        bool pixels{};      // it is a PixelLayer
+    };
+    std::vector<LayerFactory> m_layer_factories;
+
+    // of the layer being updated/rendered; per thread, like the GL context it applies to
+    static thread_local Viewport g_viewport;
+
+    EGLContext create_context(EGLContext share) const;
     void step(float timestamp);
+    template <typename CELL>
+    void present();
+    template <typename FRAME>
+    void encode_and_write(FRAME &frame);
+    template <typename FRAME>
+    void present_banded(FRAME &frame);
+    void write_output(size_t written = 0);
+    void read_dirty_tiles(const DirtyTiles &tiles, uint8_t *pixels) const;
+    void read_rects(const std::vector<Viewport> &rects, uint8_t *pixels) const;
+    void allocate_output();
+    void allocate_render_target();
+    bool draw_layers(const std::vector<std::unique_ptr<Layer>> &layers,
+                     unsigned render_width, unsigned render_height, float timestamp,
+                     Tracer *tracer = nullptr, std::vector<Viewport> *damage = nullptr) const;
+    void damage_to_cells();
+    void add_pixel_layer(std::unique_ptr<PixelLayer> layer);
+    void update_pixel_layers(const std::vector<std::unique_ptr<PixelLayer>> &layers, float timestamp) const;
+    void render_pixel_layers(const std::vector<std::unique_ptr<PixelLayer>> &layers, uint8_t *pixels,
+                             unsigned begin_row, unsigned end_row, ThreadPool *pool) const;
+    Viewport resolve_view(const View &view, unsigned render_width, unsigned render_height) const;
+    static void bind_viewport(const Viewport &viewport);
+
+    struct ExportQueue;
+    int run_export();
+    template <typename CELL>
+    void export_worker(ExportQueue &queue, EGLContext ctx) const;
+    bool scaled() const { return m_render_width != m_width || m_render_height != m_height; }
+    // false with BLOTGL_GL=0
+    bool gl() const { return m_ctx != EGL_NO_CONTEXT; }
 
     static bool g_registered_sig_handler;
     static bool g_interrupted;
@@ -62,20 +183,44 @@ protected:
     static void sig_handler(int signo);
 
 public:
-    explicit App();
+    explicit App(const Config &config = Config::from_env());
     ~App();
 
     bool update_dimensions();
+    // size of the layer currently drawing, in render target pixels
     std::pair<float,float> get_dimensions() const;
+    // where the layer currently drawing sits in the render target
+    const Viewport& get_viewport() const { return g_viewport; }
+    float get_scale() const { return m_scaler.scale(); }
+    // width over height of an output pixel as the terminal shows it, 1 if it
+    // didn't tell its size in pixels
+    float get_pixel_aspect() const { return m_pixel_aspect; }
+    const Config& config() const { return m_config; }
 
     int run();
     void stop();
 
-    template <typename T>
+    // extra arguments are copied, and passed to every T constructed
+    template <typename T, typename... ARGS>
     requires(std::is_base_of_v<Layer, T>)
-    void push()
+    void push(const View &view = {}, const ARGS&... args)
     {
-        m_layers.push_back(std::make_unique<T>());
+        constexpr bool pixels = std::is_base_of_v<PixelLayer, T>;
+        if (!pixels && !gl()) {
+            fprintf(stderr, "Only pixel layers run without GL\n");
+            throw std::runtime_error("Only pixel layers run without GL");
+        }
+        auto &factory = m_layer_factories.emplace_back(LayerFactory{
+            .create = [args...] { return std::unique_ptr<Layer>(std::make_unique<T>(args...)); },
+            .view = view,
+            .pixels = pixels,
+        });
+        auto layer = factory.create();
+        layer->set_view(view);
+        if constexpr (pixels)
+            add_pixel_layer(std::unique_ptr<PixelLayer>(static_cast<T*>(layer.release())));
+        else
+            m_layers.push_back(std::move(layer));
     }
 };
 
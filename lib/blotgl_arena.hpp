@@ -0,0 +1,124 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <stdexcept>
+#include <sys/mman.h>
+
+#include "blotgl_utils.hpp"
+
+namespace BlotGL {
+
+// One anonymous mapping, 2MB aligned and marked for transparent huge pages,
+// that per-frame buffers are carved out of with a bump pointer.  Keeping all
+// of a frame's buffers in one or two huge pages keeps the conversion loop's
+// TLB footprint flat no matter how big the terminal is.  The mapping is kept
+// across frames and only replaced when a bigger one is needed.  Less than a
+// huge page gets a plain mapping of the pages it needs, as no huge page could
+// back it anyway.
+class FrameArena final {
+public:
+    static constexpr size_t HUGE_PAGE = size_t(2) << 20;
+    static constexpr size_t PAGE = 4096;
+    static constexpr size_t ALIGN = 64;     // every allocation starts on its own cache line
+
+protected:
+    uint8_t *m_base{nullptr};
+    size_t m_capacity{};
+    size_t m_used{};
+
+    void release() {
+        if (m_base)
+            munmap(m_base, m_capacity);
+        m_base = nullptr;
+        m_capacity = 0;
+        m_used = 0;
+    }
+
+public:
+    explicit FrameArena(size_t capacity = 0) {
+        if (capacity)
+            reserve(capacity);
+    }
+    ~FrameArena() {
+        release();
+    }
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    size_t capacity() const { return m_capacity; }
+    size_t used() const { return m_used; }
+
+    // make room for at least this many bytes; contents are lost if the mapping is replaced
+    void reserve(size_t bytes) {
+        if (bytes <= m_capacity)
+            return;
+        release();
+
+        if (bytes < HUGE_PAGE) {
+            size_t size = div_round_up(bytes, PAGE) * PAGE;
+            void *ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (ptr == MAP_FAILED)
+                throw std::runtime_error("FrameArena: mmap failed");
+            m_base = (uint8_t*)ptr;
+            m_capacity = size;
+            m_used = 0;
+            return;
+        }
+
+        size_t size = div_round_up(bytes, HUGE_PAGE) * HUGE_PAGE;
+
+        // over-allocate by one huge page, then trim so the start is 2MB aligned
+        size_t mapped = size + HUGE_PAGE;
+        void *ptr = mmap(nullptr, mapped, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ptr == MAP_FAILED)
+            throw std::runtime_error("FrameArena: mmap failed");
+
+        uintptr_t start = uintptr_t(ptr);
+        uintptr_t aligned = div_round_up(start, uintptr_t(HUGE_PAGE)) * HUGE_PAGE;
+        if (aligned > start)
+            munmap(ptr, aligned - start);
+        size_t tail = (start + mapped) - (aligned + size);
+        if (tail)
+            munmap((void*)(aligned + size), tail);
+
+#ifdef MADV_HUGEPAGE
+        // only a hint, THP may be disabled on this system
+        madvise((void*)aligned, size, MADV_HUGEPAGE);
+#endif
+
+        m_base = (uint8_t*)aligned;
+        m_capacity = size;
+        m_used = 0;
+    }
+
+    // forget all allocations, keeping the mapping (and whatever it holds)
+    void reset() {
+        m_used = 0;
+    }
+
+    template <typename T>
+    T* allocate(size_t count) {
+        static_assert(alignof(T) <= ALIGN);
+        size_t offset = div_round_up(m_used, ALIGN) * ALIGN;
+        size_t bytes = count * sizeof(T);
+        if (offset + bytes > m_capacity)
+            throw std::runtime_error("FrameArena: out of space");
+        m_used = offset + bytes;
+        return reinterpret_cast<T*>(m_base + offset);
+    }
+
+    // bytes needed to allocate() the given sizes back to back
+    static constexpr size_t footprint(std::initializer_list<size_t> sizes) {
+        size_t total = 0;
+        for (size_t bytes : sizes)
+            total += (bytes + ALIGN - 1) / ALIGN * ALIGN;
+        return total;
+    }
+};
+
+}
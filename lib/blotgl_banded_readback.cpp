@@ -0,0 +1,95 @@
+#define GL_GLEXT_PROTOTYPES
+#include "blotgl_banded_readback.hpp"
+#include "blotgl_glerror.hpp"
+#include "blotgl_gl_state.hpp"
+#include "blotgl_utils.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+extern "C" {
+#include <unistd.h>
+};
+
+namespace BlotGL {
+
+BandedReadback::~BandedReadback()
+{
+    release();
+}
+
+void BandedReadback::release()
+{
+    if (m_buffers[0])
+        GLState::current().delete_buffers(2, m_buffers.data());
+    m_buffers = {};
+}
+
+unsigned BandedReadback::auto_band_rows(unsigned width, unsigned glyph_rows)
+{
+    long l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    size_t budget = (l2 > 0 ? size_t(l2) : 512 * 1024) / 2;
+    size_t row_bytes = std::max<size_t>(size_t(width) * 3, 1);
+    size_t rows = multiple_of(budget / row_bytes, size_t(glyph_rows));
+    return unsigned(std::max<size_t>(rows, glyph_rows));
+}
+
+void BandedReadback::resize(unsigned width, unsigned height, unsigned band_rows)
+{
+    band_rows = std::max(band_rows, 1u);
+    if (width == m_width && height == m_height && band_rows == m_band_rows && m_buffers[0])
+        return;
+    release();
+
+    m_width = width;
+    m_height = height;
+    m_band_rows = band_rows;
+    m_bands = div_round_up(height, band_rows);
+
+    const size_t bytes = size_t(width) * band_rows * 3;
+    GL(glCreateBuffers(2, m_buffers.data()));
+    for (GLuint buffer : m_buffers)
+        GL(glNamedBufferData(buffer, bytes, nullptr, GL_STREAM_READ));
+}
+
+unsigned BandedReadback::band_bottom(unsigned band) const
+{
+    return std::min(band_top(band) + m_band_rows, m_height);
+}
+
+void BandedReadback::read(unsigned band)
+{
+    const size_t slot = band & 1;
+    const unsigned top = band_top(band), bottom = band_bottom(band);
+
+    GLState &gl = GLState::current();
+    GL(glPixelStorei(GL_PACK_ALIGNMENT, 1));
+    gl.bind_buffer(GL_PIXEL_PACK_BUFFER, m_buffers[slot]);
+    GL(glReadPixels(0, m_height - bottom, m_width, bottom - top, GL_RGB, GL_UNSIGNED_BYTE, nullptr));
+    // other readbacks are into memory, not this
+    gl.bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
+    GL(glPixelStorei(GL_PACK_ALIGNMENT, 4));
+
+    // the read is queued, not waited for
+    GL(glFlush());
+}
+
+void BandedReadback::fetch(unsigned band, uint8_t *pixels)
+{
+    const size_t slot = band & 1;
+    const unsigned top = band_top(band), bottom = band_bottom(band);
+    const size_t bytes = size_t(m_width) * (bottom - top) * 3;
+
+    // mapping waits for the read to land, for as long as that takes
+    // GL rows count from the bottom, the band's lowest row goes first
+    uint8_t *dst = pixels + size_t(m_height - bottom) * m_width * 3;
+    const void *src = glMapNamedBufferRange(m_buffers[slot], 0, bytes, GL_MAP_READ_BIT);
+    if (!src) {
+        GL(glGetNamedBufferSubData(m_buffers[slot], 0, bytes, dst));
+        return;
+    }
+    std::memcpy(dst, src, bytes);
+    GL(glUnmapNamedBuffer(m_buffers[slot]));
+}
+
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+extern "C" {
+#include <GL/gl.h>
+#include <GL/glext.h>
+};
+
+namespace BlotGL {
+
+// Reads the output back in horizontal bands, top first, through two pack
+// buffers: while the CPU converts, encodes and writes one band, the next one
+// is already on its way, so the first cells reach the terminal long before
+// the whole frame would have been read.  A band is sized to stay in the CPU's cache from
+// the copy out of the pack buffer until it is converted.
+class BandedReadback final {
+protected:
+    unsigned m_width{};
+    unsigned m_height{};
+    unsigned m_band_rows{};     // pixel rows per band, the last one may be short
+    unsigned m_bands{};
+    std::array<GLuint, 2> m_buffers{};
+
+    void release();
+
+public:
+    explicit BandedReadback() = default;
+    ~BandedReadback();
+
+    BandedReadback(const BandedReadback&) = delete;
+    BandedReadback& operator=(const BandedReadback&) = delete;
+
+    // pixel rows per band for RGB output this wide: a whole number of
+    // glyph_rows, as much as fits in half of the L2 cache
+    static unsigned auto_band_rows(unsigned width, unsigned glyph_rows);
+
+    // split a width x height output into bands of band_rows pixel rows
+    void resize(unsigned width, unsigned height, unsigned band_rows);
+
+    unsigned bands() const { return m_bands; }
+    // pixel rows of a band, counted from the top
+    unsigned band_top(unsigned band) const { return band * m_band_rows; }
+    unsigned band_bottom(unsigned band) const;
+
+    // start reading a band of the bound read framebuffer into a pack buffer;
+    // at most two are in flight, fetch() one before reading a third
+    void read(unsigned band);
+    // wait for a band read earlier, and copy it to where it goes in a
+    // full-size RGB image with GL's bottom row first
+    void fetch(unsigned band, uint8_t *pixels);
+};
+
+}
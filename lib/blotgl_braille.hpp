@@ -10,7 +10,7 @@ static const constexpr size_t BRAILLE_GLYPH_COLS = 2;
 static const constexpr size_t BRAILLE_GLYPH_ROWS = 4;
 static const constexpr size_t BRAILLE_GLYPH_SIZE = (BRAILLE_GLYPH_ROWS * BRAILLE_GLYPH_COLS);
 
-inline auto braille_glyph_map_index(auto x, auto y) { return y * BRAILLE_GLYPH_COLS + x; }
+constexpr auto braille_glyph_map_index(auto x, auto y) { return y * BRAILLE_GLYPH_COLS + x; }
 
 // this maps the order of bits in a 2x4 image into braille character glyph locations
 static const constexpr std::array<uint8_t,BRAILLE_GLYPH_SIZE> braille_mapping = {
@@ -0,0 +1,205 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <string_view>
+#include <optional>
+
+#include "blotgl_braille.hpp"
+#include "blotgl_color.hpp"
+
+namespace BlotGL {
+
+// Cell policies describe how a block of COLS x ROWS pixels maps onto a single
+// terminal character.  Each pixel that is lit sets bit_at(x,y) in the cell's
+// mask, and codepoint(mask) is the character that draws it.  Policies with
+// BACKGROUND set carry a second color per cell, used for the unlit part; with
+// SOLID set too, the glyph with every bit lit covers the background entirely.
+
+// 2x4 dots, one color (U+2800..U+28FF)
+struct BrailleCell {
+    static constexpr const char *NAME = "braille";
+    static constexpr size_t COLS = BRAILLE_GLYPH_COLS;
+    static constexpr size_t ROWS = BRAILLE_GLYPH_ROWS;
+    static constexpr bool BACKGROUND = false;
+
+    static constexpr uint8_t bit_at(size_t x, size_t y) {
+        return braille_mapping[braille_glyph_map_index(x, y)];
+    }
+    static constexpr char32_t codepoint(uint8_t mask) {
+        return BRAILLE_GLYPH_BASE + mask;
+    }
+};
+
+// 2x4 dots in the foreground color over the background color, each cell's
+// pixels split into the two colors that tell them apart best
+struct Braille2Cell {
+    static constexpr const char *NAME = "braille2";
+    static constexpr size_t COLS = BRAILLE_GLYPH_COLS;
+    static constexpr size_t ROWS = BRAILLE_GLYPH_ROWS;
+    static constexpr bool BACKGROUND = true;
+    static constexpr bool SOLID = false;    // the background shows between the dots
+
+    static constexpr uint8_t bit_at(size_t x, size_t y) {
+        return BrailleCell::bit_at(x, y);
+    }
+    static constexpr char32_t codepoint(uint8_t mask) {
+        // no dots is all background, a space is shorter than U+2800
+        return mask ? BRAILLE_GLYPH_BASE + mask : ' ';
+    }
+};
+
+// 1x2 upper/lower half blocks, top pixel is the foreground and bottom the background
+struct HalfBlockCell {
+    static constexpr const char *NAME = "halfblock";
+    static constexpr size_t COLS = 1;
+    static constexpr size_t ROWS = 2;
+    static constexpr bool BACKGROUND = true;
+    static constexpr bool SOLID = true;
+
+    static constexpr char32_t UPPER_HALF = 0x2580;
+    static constexpr char32_t LOWER_HALF = 0x2584;
+    static constexpr char32_t FULL_BLOCK = 0x2588;
+
+    static constexpr uint8_t bit_at(size_t x, size_t y) {
+        return uint8_t(1u << y);
+    }
+    static constexpr char32_t codepoint(uint8_t mask) {
+        constexpr std::array<char32_t,4> map = { ' ', UPPER_HALF, LOWER_HALF, FULL_BLOCK };
+        return map[mask & 3];
+    }
+};
+
+// 2x2 quadrant blocks, one color (U+2596..U+259F plus the half/full blocks)
+struct QuadrantCell {
+    static constexpr const char *NAME = "quadrant";
+    static constexpr size_t COLS = 2;
+    static constexpr size_t ROWS = 2;
+    static constexpr bool BACKGROUND = false;
+
+    static constexpr uint8_t bit_at(size_t x, size_t y) {
+        return uint8_t(1u << (x + y * COLS));
+    }
+    static constexpr char32_t codepoint(uint8_t mask) {
+        // bits: 1=top-left, 2=top-right, 4=bottom-left, 8=bottom-right
+        constexpr std::array<char32_t,16> map = {
+            ' ',    0x2598, 0x259D, 0x2580,
+            0x2596, 0x258C, 0x259E, 0x259B,
+            0x2597, 0x259A, 0x2590, 0x259C,
+            0x2584, 0x2599, 0x259F, 0x2588,
+        };
+        return map[mask & 15];
+    }
+};
+
+// 2x3 sextant blocks, one color (U+1FB00..U+1FB3B, from Symbols for Legacy Computing)
+struct SextantCell {
+    static constexpr const char *NAME = "sextant";
+    static constexpr size_t COLS = 2;
+    static constexpr size_t ROWS = 3;
+    static constexpr bool BACKGROUND = false;
+
+    static constexpr uint8_t bit_at(size_t x, size_t y) {
+        return uint8_t(1u << (x + y * COLS));
+    }
+    static constexpr char32_t codepoint(uint8_t mask) {
+        // the block skips the four patterns that already exist elsewhere
+        mask &= 63;
+        switch (mask) {
+            case 0:  return ' ';
+            case 21: return 0x258C; // left half
+            case 42: return 0x2590; // right half
+            case 63: return 0x2588; // full block
+        }
+        return 0x1FB00 + mask - 1 - (mask > 21) - (mask > 42);
+    }
+};
+
+// a cell's glyph mask and color in 4 bytes, written with a single aligned store
+struct alignas(4) PackedCell {
+    color24 fg;
+    uint8_t glyph;
+
+    static void store(PackedCell *dst, color24 fg, uint8_t glyph) {
+        if constexpr (std::endian::native == std::endian::little) {
+            // compilers otherwise tend to emit the fields as separate byte stores
+            uint32_t word = uint32_t(fg.r) | uint32_t(fg.g) << 8 | uint32_t(fg.b) << 16
+                          | uint32_t(glyph) << 24;
+            std::memcpy(static_cast<void*>(dst), &word, sizeof(word));
+        } else {
+            dst->fg = fg;
+            dst->glyph = glyph;
+        }
+    }
+};
+static_assert(sizeof(PackedCell) == 4);
+
+// the same with a background color, for policies with BACKGROUND
+struct alignas(8) PackedCellBg {
+    color24 fg;
+    uint8_t glyph;
+    color24 bg;
+    uint8_t unused;
+
+    static void store(PackedCellBg *dst, color24 fg, uint8_t glyph, color24 bg) {
+        if constexpr (std::endian::native == std::endian::little) {
+            uint64_t word = uint64_t(fg.r) | uint64_t(fg.g) << 8 | uint64_t(fg.b) << 16
+                          | uint64_t(glyph) << 24
+                          | uint64_t(bg.r) << 32 | uint64_t(bg.g) << 40 | uint64_t(bg.b) << 48;
+            std::memcpy(static_cast<void*>(dst), &word, sizeof(word));
+        } else {
+            *dst = { .fg = fg, .glyph = glyph, .bg = bg };
+        }
+    }
+};
+static_assert(sizeof(PackedCellBg) == 8);
+
+enum class CellEncoding {
+    Braille,
+    Braille2,
+    HalfBlock,
+    Quadrant,
+    Sextant,
+};
+
+// call fn.template operator()<CELL>() with the policy matching a runtime encoding
+template <typename FN>
+decltype(auto) dispatch_cell_encoding(CellEncoding encoding, FN &&fn)
+{
+    switch (encoding) {
+        case CellEncoding::Braille2:  return fn.template operator()<Braille2Cell>();
+        case CellEncoding::HalfBlock: return fn.template operator()<HalfBlockCell>();
+        case CellEncoding::Quadrant:  return fn.template operator()<QuadrantCell>();
+        case CellEncoding::Sextant:   return fn.template operator()<SextantCell>();
+        case CellEncoding::Braille:   break;
+    }
+    return fn.template operator()<BrailleCell>();
+}
+
+inline std::pair<size_t,size_t> cell_geometry(CellEncoding encoding)
+{
+    return dispatch_cell_encoding(encoding, []<typename CELL>() {
+        return std::pair<size_t,size_t>{ CELL::COLS, CELL::ROWS };
+    });
+}
+
+inline const char* cell_encoding_name(CellEncoding encoding)
+{
+    return dispatch_cell_encoding(encoding, []<typename CELL>() {
+        return CELL::NAME;
+    });
+}
+
+inline std::optional<CellEncoding> parse_cell_encoding(std::string_view name)
+{
+    for (auto encoding : { CellEncoding::Braille, CellEncoding::Braille2, CellEncoding::HalfBlock,
+                           CellEncoding::Quadrant, CellEncoding::Sextant }) {
+        if (name == cell_encoding_name(encoding))
+            return encoding;
+    }
+    return std::nullopt;
+}
+
+}
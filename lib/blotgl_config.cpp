@@ -0,0 +1,85 @@
+#include "blotgl_config.hpp"
+
+#include <cstdlib>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <fmt/core.h>
+
+namespace BlotGL {
+
+static const char* env(const char *name)
+{
+    const char *value = std::getenv(name);
+    return (value && *value) ? value : nullptr;
+}
+
+template <typename T>
+static void env_number(const char *name, T &out)
+{
+    const char *value = env(name);
+    if (!value)
+        return;
+    double number;
+    try {
+        number = std::stod(value);
+    } catch (const std::exception &ex) {
+        fmt::println(stderr, "ignoring {}={}: not a number", name, value);
+        return;
+    }
+    if constexpr (std::is_same_v<T, bool>) {
+        out = number != 0;
+    } else {
+        // converting what T can't hold is undefined, e.g. -1 into an unsigned
+        if (!(number >= double(std::numeric_limits<T>::lowest())
+                && number <= double(std::numeric_limits<T>::max()))) {
+            fmt::println(stderr, "ignoring {}={}: out of range", name, value);
+            return;
+        }
+        out = static_cast<T>(number);
+    }
+}
+
+Config Config::from_env()
+{
+    Config config;
+    if (const char *value = env("BLOTGL_ENCODING")) {
+        if (auto encoding = parse_cell_encoding(value))
+            config.encoding = *encoding;
+        else
+            fmt::println(stderr, "ignoring BLOTGL_ENCODING={}: unknown encoding", value);
+    }
+    env_number("BLOTGL_COLOR_TOLERANCE", config.color_tolerance);
+    if (const char *value = env("BLOTGL_ISA")) {
+        if (auto isa = parse_isa(value))
+            config.isa = *isa;
+        else
+            fmt::println(stderr, "ignoring BLOTGL_ISA={}: unknown instruction set", value);
+    }
+    env_number("BLOTGL_GL", config.gl);
+    env_number("BLOTGL_CHECKERBOARD", config.checkerboard);
+    env_number("BLOTGL_THREADS", config.threads);
+    env_number("BLOTGL_PROBE", config.probe);
+    env_number("BLOTGL_PROBE_TIMEOUT_MS", config.probe_timeout_ms);
+    env_number("BLOTGL_DELTA", config.delta);
+    env_number("BLOTGL_DELTA_DISTANCE", config.delta_distance);
+    env_number("BLOTGL_DELTA_REFRESH", config.delta_refresh);
+    env_number("BLOTGL_SCROLL", config.scroll);
+    env_number("BLOTGL_TARGET_FRAME_MS", config.target_frame_ms);
+    env_number("BLOTGL_MIN_SCALE", config.min_scale);
+    env_number("BLOTGL_ZERO_COPY", config.zero_copy);
+    env_number("BLOTGL_DIRTY_TILES", config.dirty_tiles);
+    env_number("BLOTGL_BANDS", config.bands);
+    env_number("BLOTGL_BAND_ROWS", config.band_rows);
+    if (const char *value = env("BLOTGL_TRACE"))
+        config.trace_path = value;
+    env_number("BLOTGL_TRACE_EVENTS", config.trace_events);
+    if (const char *value = env("BLOTGL_EXPORT"))
+        config.export_path = value;
+    env_number("BLOTGL_EXPORT_FRAMES", config.export_frames);
+    env_number("BLOTGL_EXPORT_FPS", config.export_fps);
+    env_number("BLOTGL_EXPORT_THREADS", config.export_threads);
+    return config;
+}
+
+}
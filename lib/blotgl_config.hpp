@@ -0,0 +1,70 @@
+#pragma once
+#include <optional>
+#include <string>
+
+#include "blotgl_cell.hpp"
+#include "blotgl_kernels.hpp"
+
+namespace BlotGL {
+
+// runtime knobs, read from BLOTGL_* environment variables at startup
+struct Config {
+    // how pixels map onto terminal characters
+    CellEncoding encoding{CellEncoding::Braille};
+    // colors closer than this on every channel are sent as one (0 is exact)
+    unsigned color_tolerance{0};
+    // kernels to convert and encode with, instead of the best this CPU runs (for benchmarks)
+    std::optional<Isa> isa;
+
+    // render with OpenGL; without it there is no GPU involved and only pixel layers run
+    bool gl{true};
+    // shader layers that allow it shade half their pixels a frame, the rest kept from the last
+    bool checkerboard{false};
+    // threads pixel layers are drawn on, counting the render thread (0 is one per core)
+    unsigned threads{0};
+
+    // ask the terminal what it supports: 0 assumes truecolor and nothing else,
+    // 1 asks once per terminal type and caches the answer, 2 asks every time
+    unsigned probe{1};
+    unsigned probe_timeout_ms{200};
+
+    // only send cells that changed since the last frame, instead of redrawing everything
+    bool delta{false};
+    // delta: leave cells whose color moved less than this (about luma steps, 0 is exact)
+    float delta_distance{0};
+    // delta: re-send a cell left showing an older color after this many frames (0 never)
+    unsigned delta_refresh{30};
+    // delta: scroll the terminal when a frame is the last one moved, instead of resending it
+    bool scroll{true};
+
+    // dynamic resolution: keep GPU time per frame near this many milliseconds (0 disables)
+    double target_frame_ms{0};
+    // dynamic resolution: never render below this fraction of the terminal resolution
+    float min_scale{0.25f};
+
+    // render into a buffer the CPU maps, instead of copying each frame out with glReadPixels
+    bool zero_copy{true};
+    // compare each frame with the last on the GPU, and only read back and convert what changed
+    bool dirty_tiles{false};
+    // read back in bands, converting and encoding each while the next is read
+    bool bands{false};
+    // bands: cell rows per band (0 is as many as fit in half the L2 cache)
+    unsigned band_rows{0};
+
+    // write a Chrome trace of every frame's CPU and GPU stages to this file on exit
+    std::string trace_path;
+    // trace: events kept, the oldest are dropped past this
+    unsigned trace_events{1u << 16};
+
+    // offline export: render frames as fast as possible into this file instead of the terminal
+    std::string export_path;
+    // offline export: how many frames, at what frame rate of the timestamps
+    unsigned export_frames{300};
+    double export_fps{30};
+    // offline export: worker threads, each with its own GL context (0 is one per core)
+    unsigned export_threads{0};
+
+    static Config from_env();
+};
+
+}
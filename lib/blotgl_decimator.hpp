@@ -0,0 +1,109 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace BlotGL {
+
+// What a line through a run of samples looks like in one pixel column: where
+// it enters and leaves, and how far it reaches.  Drawn first, min, max, last
+// at the same x, it rasterizes exactly like all the samples would (M4).
+struct M4 {
+    float first{}, min{}, max{}, last{};
+
+    void merge(const M4 &later) {
+        min = std::min(min, later.min);
+        max = std::max(max, later.max);
+        last = later.last;
+    }
+};
+
+// Keeps the last `window` samples of a series as a fixed number of M4
+// buckets, oldest dropped as new ones complete.  Adding a sample is a compare
+// and two stores; what a frame costs depends on the bucket and column counts,
+// never on how many samples came in.  Merging buckets into columns is exact,
+// so any width up to the bucket count is drawn as if from the raw samples.
+class Decimator final {
+protected:
+    size_t m_per_bucket;
+    std::vector<M4> m_buckets;  // complete ones, a ring
+    size_t m_next{};            // where the next complete bucket goes
+    size_t m_complete{};        // up to m_buckets.size()
+    M4 m_current{};
+    size_t m_in_current{};
+
+    // by age, 0 the one being filled, 1 the last completed, ...; null if none
+    const M4* bucket(size_t age) const {
+        if (age == 0)
+            return m_in_current ? &m_current : nullptr;
+        if (age > m_complete)
+            return nullptr;
+        size_t size = m_buckets.size();
+        return &m_buckets[(m_next + size - age) % size];
+    }
+
+public:
+    explicit Decimator(size_t window = 1 << 20, size_t buckets = 4096)
+    : m_per_bucket(std::max<size_t>(window / std::max<size_t>(buckets, 1), 1)),
+      m_buckets(std::max<size_t>(buckets, 1) - 1) {
+        if (m_buckets.empty())
+            m_buckets.resize(1);
+    }
+
+    size_t buckets() const { return m_buckets.size() + 1; }
+    size_t window() const { return buckets() * m_per_bucket; }
+
+    void add(const float *samples, size_t count) {
+        while (count) {
+            size_t n = std::min(count, m_per_bucket - m_in_current);
+            M4 run{ samples[0], samples[0], samples[0], samples[n - 1] };
+            // branch-free, so the compiler can vectorize it
+            for (size_t i = 1; i < n; i++) {
+                run.min = samples[i] < run.min ? samples[i] : run.min;
+                run.max = samples[i] > run.max ? samples[i] : run.max;
+            }
+            if (m_in_current)
+                m_current.merge(run);
+            else
+                m_current = run;
+            m_in_current += n;
+            samples += n;
+            count -= n;
+
+            if (m_in_current == m_per_bucket) {
+                m_buckets[m_next] = m_current;
+                m_next = (m_next + 1) % m_buckets.size();
+                m_complete = std::min(m_complete + 1, m_buckets.size());
+                m_in_current = 0;
+            }
+        }
+    }
+
+    // the window spread over `count` columns, newest at the right; a column with
+    // nothing in it yet is left out.  fn(size_t column, const M4&) in order.
+    template <typename FN>
+    void columns(size_t count, FN &&fn) const {
+        const size_t total = buckets();
+        for (size_t column = 0; column < count; column++) {
+            // buckets [begin, end) of the window, 0 the oldest
+            size_t begin = column * total / count;
+            size_t end = (column + 1) * total / count;
+            M4 merged{};
+            bool any = false;
+            for (size_t i = begin; i < end; i++) {
+                const M4 *b = bucket(total - 1 - i);
+                if (!b)
+                    continue;
+                if (any)
+                    merged.merge(*b);
+                else
+                    merged = *b;
+                any = true;
+            }
+            if (any)
+                fn(column, merged);
+        }
+    }
+};
+
+}
@@ -0,0 +1,149 @@
+#define GL_GLEXT_PROTOTYPES
+#include "blotgl_dirty_tiles.hpp"
+#include "blotgl_shader.hpp"
+#include "blotgl_glerror.hpp"
+#include "blotgl_utils.hpp"
+
+#include <algorithm>
+
+namespace BlotGL {
+
+// a triangle covering the mask
+static constexpr const char *vertex_source = R"glsl(
+#version 460 core
+void main()
+{
+    vec2 pos = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(pos * 2.0 - 1.0, 0.0, 1.0);
+}
+)glsl";
+
+// one fragment per tile, stopping at the first pixel that differs;
+// mask rows count from the top, output rows from the bottom
+static constexpr const char *fragment_source = R"glsl(
+#version 460 core
+layout(binding = 0) uniform sampler2D u_current;
+layout(binding = 1) uniform sampler2D u_previous;
+layout(location = 0) uniform ivec2 u_tile;
+layout(location = 1) uniform ivec2 u_size;
+layout(location = 0) out vec4 o_dirty;
+void main()
+{
+    ivec2 tile = ivec2(gl_FragCoord.xy);
+    int x0 = tile.x * u_tile.x;
+    int x1 = min(x0 + u_tile.x, u_size.x);
+    int y0 = tile.y * u_tile.y;
+    int y1 = min(y0 + u_tile.y, u_size.y);
+    for (int y = y0; y < y1; y++) {
+        int gl_y = u_size.y - 1 - y;
+        for (int x = x0; x < x1; x++) {
+            ivec2 p = ivec2(x, gl_y);
+            if (texelFetch(u_current, p, 0).rgb != texelFetch(u_previous, p, 0).rgb) {
+                o_dirty = vec4(1.0);
+                return;
+            }
+        }
+    }
+    o_dirty = vec4(0.0);
+}
+)glsl";
+
+DirtyTiles::DirtyTiles(unsigned tile_width, unsigned tile_height)
+: m_tile_width(std::max(tile_width, 1u)),
+  m_tile_height(std::max(tile_height, 1u)),
+  m_shader(std::make_unique<Shader>(vertex_source, fragment_source))
+{
+    // core profile draws need a vertex array, even an empty one
+    GL(glCreateVertexArrays(1, &m_vertex_array));
+}
+
+DirtyTiles::~DirtyTiles()
+{
+    release();
+    GLState::current().delete_vertex_arrays(1, &m_vertex_array);
+}
+
+void DirtyTiles::release()
+{
+    if (!m_fbos[0])
+        return;
+    GLState::current().delete_framebuffers(2, m_fbos.data());
+    GL(glDeleteTextures(2, m_textures.data()));
+    GLState::current().delete_framebuffers(1, &m_mask_fbo);
+    GL(glDeleteTextures(1, &m_mask_texture));
+    m_fbos = {};
+    m_textures = {};
+    m_mask_fbo = 0;
+    m_mask_texture = 0;
+}
+
+void DirtyTiles::resize(unsigned width, unsigned height)
+{
+    release();
+
+    m_width = width;
+    m_height = height;
+    m_columns = div_round_up(width, m_tile_width);
+    m_rows = div_round_up(height, m_tile_height);
+    m_mask.assign(size_t(m_columns) * m_rows, 1);
+    m_dirty = m_mask.size();
+    m_valid = false;
+
+    GL(glCreateTextures(GL_TEXTURE_2D, 2, m_textures.data()));
+    GL(glCreateFramebuffers(2, m_fbos.data()));
+    for (size_t i = 0; i < 2; i++) {
+        GL(glTextureStorage2D(m_textures[i], 1, GL_RGB8, width, height));
+        GL(glNamedFramebufferTexture(m_fbos[i], GL_COLOR_ATTACHMENT0, m_textures[i], 0));
+    }
+
+    GL(glCreateTextures(GL_TEXTURE_2D, 1, &m_mask_texture));
+    GL(glTextureStorage2D(m_mask_texture, 1, GL_R8, m_columns, m_rows));
+    GL(glCreateFramebuffers(1, &m_mask_fbo));
+    GL(glNamedFramebufferTexture(m_mask_fbo, GL_COLOR_ATTACHMENT0, m_mask_texture, 0));
+}
+
+void DirtyTiles::detect(GLuint fbo, unsigned width, unsigned height)
+{
+    if (width != m_width || height != m_height || !m_fbos[0])
+        resize(width, height);
+
+    // keep this frame, to compare the next one against
+    GLuint current = m_textures[m_current];
+    GLuint previous = m_textures[m_current ^ 1];
+    GL(glBlitNamedFramebuffer(fbo, m_fbos[m_current], 0, 0, width, height,
+                              0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST));
+    m_current ^= 1;
+
+    if (!m_valid) {
+        std::fill(m_mask.begin(), m_mask.end(), 1);
+        m_dirty = m_mask.size();
+        m_valid = true;
+        return;
+    }
+
+    // a layer may have left blending on, which would mix into the mask
+    GLboolean blend = glIsEnabled(GL_BLEND);
+    GL(glDisable(GL_BLEND));
+
+    GLState &gl = GLState::current();
+    gl.bind_framebuffer(GL_FRAMEBUFFER, m_mask_fbo);
+    gl.viewport(0, 0, m_columns, m_rows);
+    m_shader->use();
+    gl.uniform(0, GLint(m_tile_width), GLint(m_tile_height));
+    gl.uniform(1, GLint(width), GLint(height));
+    GL(glBindTextureUnit(0, current));
+    GL(glBindTextureUnit(1, previous));
+    gl.bind_vertex_array(m_vertex_array);
+    GL(glDrawArrays(GL_TRIANGLES, 0, 3));
+
+    GL(glPixelStorei(GL_PACK_ALIGNMENT, 1));
+    GL(glReadPixels(0, 0, m_columns, m_rows, GL_RED, GL_UNSIGNED_BYTE, m_mask.data()));
+    GL(glPixelStorei(GL_PACK_ALIGNMENT, 4));
+    m_dirty = std::count_if(m_mask.begin(), m_mask.end(), [](uint8_t d) { return d != 0; });
+
+    if (blend)
+        GL(glEnable(GL_BLEND));
+    gl.bind_framebuffer(GL_FRAMEBUFFER, fbo);
+}
+
+}
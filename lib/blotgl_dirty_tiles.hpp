@@ -0,0 +1,69 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+extern "C" {
+#include <GL/gl.h>
+#include <GL/glext.h>
+};
+
+namespace BlotGL {
+
+class Shader;
+
+// Finds the tiles of the output that changed since the previous frame, on the
+// GPU, so only those are read back and converted.  Each frame's output is
+// copied into one of two textures, and a pass one fragment per tile compares
+// it with the other; what comes back to the CPU is a byte per tile.
+class DirtyTiles final {
+protected:
+    unsigned m_tile_width;      // pixels per tile
+    unsigned m_tile_height;
+    unsigned m_width{};         // output pixels
+    unsigned m_height{};
+    unsigned m_columns{};       // tiles across and down
+    unsigned m_rows{};
+
+    std::array<GLuint, 2> m_textures{};     // this frame's output and the last one's
+    std::array<GLuint, 2> m_fbos{};
+    size_t m_current{};
+    bool m_valid{false};        // whether the other texture holds the last frame
+    GLuint m_mask_texture{};
+    GLuint m_mask_fbo{};
+    GLuint m_vertex_array{};
+    std::unique_ptr<Shader> m_shader;
+
+    std::vector<uint8_t> m_mask;    // columns x rows, top row first, non-zero if dirty
+    size_t m_dirty{};
+
+    void resize(unsigned width, unsigned height);
+    void release();
+
+public:
+    // tiles are this many output pixels, best a whole number of cells
+    explicit DirtyTiles(unsigned tile_width, unsigned tile_height);
+    ~DirtyTiles();
+
+    DirtyTiles(const DirtyTiles&) = delete;
+    DirtyTiles& operator=(const DirtyTiles&) = delete;
+
+    // compare what fbo holds now with what it held last call; the first
+    // frame and any after a resize or invalidate() are all dirty
+    void detect(GLuint fbo, unsigned width, unsigned height);
+    // the CPU's copy no longer matches, everything is dirty next time
+    void invalidate() { m_valid = false; }
+
+    unsigned tile_width() const { return m_tile_width; }
+    unsigned tile_height() const { return m_tile_height; }
+    unsigned columns() const { return m_columns; }
+    unsigned rows() const { return m_rows; }
+
+    // row counts from the top of the image, unlike GL
+    bool dirty(unsigned column, unsigned row) const { return m_mask[row * m_columns + column]; }
+    size_t dirty_count() const { return m_dirty; }
+    size_t count() const { return m_mask.size(); }
+};
+
+}
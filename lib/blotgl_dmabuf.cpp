@@ -0,0 +1,101 @@
+#define GL_GLEXT_PROTOTYPES
+#include "blotgl_dmabuf.hpp"
+#include "blotgl_glerror.hpp"
+
+#include <cstring>
+
+extern "C" {
+#include <GL/glext.h>
+#include <linux/dma-buf.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+};
+
+namespace BlotGL {
+
+// from GL_OES_EGL_image, which desktop GL headers don't declare
+using EGLImageTargetRenderbufferStorageOES = void (*)(GLenum target, void *image);
+
+std::unique_ptr<DmaBufTarget> DmaBufTarget::create(struct gbm_device *gbm, EGLDisplay dpy,
+                                                   unsigned width, unsigned height)
+{
+    const char *exts = eglQueryString(dpy, EGL_EXTENSIONS);
+    if (!exts || !strstr(exts, "EGL_EXT_image_dma_buf_import"))
+        return nullptr;
+
+    auto create_image = (PFNEGLCREATEIMAGEKHRPROC)eglGetProcAddress("eglCreateImageKHR");
+    auto target_storage = (EGLImageTargetRenderbufferStorageOES)
+        eglGetProcAddress("glEGLImageTargetRenderbufferStorageOES");
+    if (!create_image || !target_storage)
+        return nullptr;
+
+    // XBGR8888 is R, G, B, X in memory; linear so the CPU can walk its rows
+    constexpr uint32_t format = GBM_FORMAT_XBGR8888;
+    std::unique_ptr<DmaBufTarget> target(new DmaBufTarget());
+    target->m_dpy = dpy;
+    target->m_bo = gbm_bo_create(gbm, width, height, format,
+                                 GBM_BO_USE_RENDERING | GBM_BO_USE_LINEAR);
+    if (!target->m_bo)
+        return nullptr;
+
+    target->m_fd = gbm_bo_get_fd(target->m_bo);
+    target->m_stride = gbm_bo_get_stride(target->m_bo);
+    target->m_offset = gbm_bo_get_offset(target->m_bo, 0);
+    if (target->m_fd < 0)
+        return nullptr;
+
+    const EGLint attribs[] = {
+        EGL_WIDTH, EGLint(width),
+        EGL_HEIGHT, EGLint(height),
+        EGL_LINUX_DRM_FOURCC_EXT, EGLint(format),
+        EGL_DMA_BUF_PLANE0_FD_EXT, target->m_fd,
+        EGL_DMA_BUF_PLANE0_OFFSET_EXT, EGLint(target->m_offset),
+        EGL_DMA_BUF_PLANE0_PITCH_EXT, EGLint(target->m_stride),
+        EGL_NONE
+    };
+    target->m_image = create_image(dpy, EGL_NO_CONTEXT, EGL_LINUX_DMA_BUF_EXT, nullptr, attribs);
+    if (target->m_image == EGL_NO_IMAGE_KHR)
+        return nullptr;
+
+    target->m_map_size = target->m_offset + target->m_stride * height;
+    void *map = mmap(nullptr, target->m_map_size, PROT_READ, MAP_SHARED, target->m_fd, 0);
+    if (map == MAP_FAILED)
+        return nullptr;
+    target->m_map = static_cast<uint8_t*>(map);
+
+    target_storage(GL_RENDERBUFFER, target->m_image);
+    if (glGetError() != GL_NO_ERROR)
+        return nullptr;
+
+    return target;
+}
+
+DmaBufTarget::~DmaBufTarget()
+{
+    if (m_map)
+        munmap(m_map, m_map_size);
+    if (m_image != EGL_NO_IMAGE_KHR) {
+        auto destroy_image = (PFNEGLDESTROYIMAGEKHRPROC)eglGetProcAddress("eglDestroyImageKHR");
+        if (destroy_image)
+            destroy_image(m_dpy, m_image);
+    }
+    if (m_fd >= 0)
+        close(m_fd);
+    if (m_bo)
+        gbm_bo_destroy(m_bo);
+}
+
+void DmaBufTarget::begin_cpu_access()
+{
+    struct dma_buf_sync sync{ .flags = DMA_BUF_SYNC_START | DMA_BUF_SYNC_READ };
+    ioctl(m_fd, DMA_BUF_IOCTL_SYNC, &sync);
+}
+
+void DmaBufTarget::end_cpu_access()
+{
+    struct dma_buf_sync sync{ .flags = DMA_BUF_SYNC_END | DMA_BUF_SYNC_READ };
+    ioctl(m_fd, DMA_BUF_IOCTL_SYNC, &sync);
+}
+
+}
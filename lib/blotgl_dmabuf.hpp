@@ -0,0 +1,50 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+extern "C" {
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GL/gl.h>
+#include <gbm.h>
+};
+
+namespace BlotGL {
+
+// A linear gbm_bo that a renderbuffer renders straight into, mapped for the
+// CPU through its dma-buf.  On integrated GPUs that is the same memory, so
+// frames are converted where they were rendered, without a glReadPixels copy.
+// Pixels are RGBX, 4 bytes each, rows bottom-up as GL draws them, stride apart.
+class DmaBufTarget final {
+protected:
+    EGLDisplay m_dpy{EGL_NO_DISPLAY};
+    struct gbm_bo *m_bo{nullptr};
+    int m_fd{-1};
+    EGLImageKHR m_image{EGL_NO_IMAGE_KHR};
+    uint8_t *m_map{nullptr};
+    size_t m_map_size{};
+    size_t m_offset{};
+    size_t m_stride{};
+
+    DmaBufTarget() = default;
+
+public:
+    // allocates, and makes it the storage of the bound GL_RENDERBUFFER;
+    // null when the driver can't do linear buffers, dma-buf import, or mmap
+    static std::unique_ptr<DmaBufTarget> create(struct gbm_device *gbm, EGLDisplay dpy,
+                                                unsigned width, unsigned height);
+    ~DmaBufTarget();
+
+    DmaBufTarget(const DmaBufTarget&) = delete;
+    DmaBufTarget& operator=(const DmaBufTarget&) = delete;
+
+    uint8_t* pixels() { return m_map + m_offset; }
+    size_t stride() const { return m_stride; }
+
+    // bracket CPU reads, after the GPU is done with the frame (glFinish)
+    void begin_cpu_access();
+    void end_cpu_access();
+};
+
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include <cstddef>
+
+namespace BlotGL {
+
+// A shader built into the binary by blotgl_embed_shader(), see
+// cmake/BlotGLShaders.cmake: the GLSL source of its file, and what it was
+// compiled to if glslangValidator was there at build time.  A ShaderLayer
+// pass's SPIR-V is the whole shader, its source is the pass's file alone.
+struct EmbeddedShader {
+    const char *name;
+    const char *source;
+    const unsigned char *spirv;     // nullptr when only the source is embedded
+    size_t spirv_size;
+};
+
+}
@@ -0,0 +1,306 @@
+#pragma once
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <algorithm>
+
+#include "blotgl_color.hpp"
+#include "blotgl_terminal.hpp"
+
+namespace BlotGL {
+
+struct EncoderOptions {
+    // colors whose channels all differ by no more than this are sent as one
+    unsigned color_tolerance{0};
+    // 24-bit colors, otherwise the nearest of the xterm 256 color palette
+    bool truecolor{true};
+    // wrap frames in synchronized output, so the terminal shows them whole
+    bool synchronized{false};
+};
+
+// nearest xterm palette entry: the 6x6x6 cube at 16..231 or the grays at 232..255
+inline uint8_t xterm256_index(color24 c)
+{
+    constexpr uint8_t levels[6] = { 0, 95, 135, 175, 215, 255 };
+    auto cube = [](uint8_t v) { return v < 48 ? 0 : v < 115 ? 1 : (v - 35) / 40; };
+    int r = cube(c.r), g = cube(c.g), b = cube(c.b);
+
+    auto dist = [&c](int r, int g, int b) {
+        return (c.r - r) * (c.r - r) + (c.g - g) * (c.g - g) + (c.b - b) * (c.b - b);
+    };
+    int average = (c.r + c.g + c.b) / 3;
+    int gray = average < 8 ? 0 : average > 238 ? 23 : (average - 8) / 10;
+    int level = 8 + gray * 10;
+
+    if (dist(level, level, level) < dist(levels[r], levels[g], levels[b]))
+        return uint8_t(232 + gray);
+    return uint8_t(16 + 36 * r + 6 * g + b);
+}
+
+// Turns a stream of cells into terminal bytes, tracking what the terminal's
+// SGR state already is so nothing redundant is sent.  Black means "terminal
+// default" for both foreground and background.  Output accumulates in an
+// internal buffer, so a frame can be written with a single write().
+class Encoder final {
+protected:
+    EncoderOptions m_options;
+    std::string m_buffer;
+
+    color24 m_fg{};         // what the terminal has right now
+    color24 m_bg{};
+    color24 m_next_fg{};    // what the next glyph wants
+    color24 m_next_bg{};
+    unsigned m_blanks{};    // blank cells not yet emitted
+    unsigned m_skips{};     // cells already showing the right thing, to be stepped over
+    bool m_cleared{};       // screen was cleared, so blank cells need not be overwritten
+
+    bool same_color(color24 a, color24 b) const {
+        // default is a different thing from a dark color, never merge across it
+        if (!a || !b)
+            return a == b;
+        if (!m_options.truecolor)
+            return xterm256_index(a) == xterm256_index(b);
+        unsigned tolerance = m_options.color_tolerance;
+        return unsigned(std::abs(int(a.r) - int(b.r))) <= tolerance
+            && unsigned(std::abs(int(a.g) - int(b.g))) <= tolerance
+            && unsigned(std::abs(int(a.b) - int(b.b))) <= tolerance;
+    }
+
+    void put_uint(unsigned value) {
+        char digits[10];
+        int n = 0;
+        do {
+            digits[n++] = char('0' + value % 10);
+            value /= 10;
+        } while (value);
+        while (n)
+            m_buffer += digits[--n];
+    }
+
+    // prefix is "38" or "48"
+    void put_color(const char *prefix, color24 c) {
+        m_buffer += prefix;
+        if (!m_options.truecolor) {
+            m_buffer += ";5;";
+            put_uint(xterm256_index(c));
+            return;
+        }
+        m_buffer += ";2;";
+        put_uint(c.r);
+        m_buffer += ';';
+        put_uint(c.g);
+        m_buffer += ';';
+        put_uint(c.b);
+    }
+
+    // one SGR for whatever changed, fg and bg combined
+    void flush_colors() {
+        bool fg = !same_color(m_next_fg, m_fg);
+        bool bg = !same_color(m_next_bg, m_bg);
+        if (!fg && !bg)
+            return;
+
+        m_buffer += TERM_CSI;
+        if (fg) {
+            if (m_next_fg)
+                put_color("38", m_next_fg);
+            else
+                m_buffer += "39";
+            m_fg = m_next_fg;
+        }
+        if (fg && bg)
+            m_buffer += ';';
+        if (bg) {
+            if (m_next_bg)
+                put_color("48", m_next_bg);
+            else
+                m_buffer += "49";
+            m_bg = m_next_bg;
+        }
+        m_buffer += 'm';
+    }
+
+    void set_default_bg() {
+        if (!m_bg)
+            return;
+        m_buffer += TERM_DEFAULT_BG;
+        m_bg = {};
+    }
+
+    void cursor_forward(unsigned n) {
+        m_buffer += TERM_CSI;
+        if (n > 1)
+            put_uint(n);
+        m_buffer += 'C';
+    }
+
+    void erase_chars(unsigned n) {
+        m_buffer += TERM_CSI;
+        if (n > 1)
+            put_uint(n);
+        m_buffer += 'X';
+    }
+
+    static unsigned csi_length(unsigned n) {
+        return 3 + (n > 1) + (n > 9) + (n > 99) + (n > 999);
+    }
+
+    void flush_blanks() {
+        unsigned n = m_blanks;
+        if (!n)
+            return;
+        m_blanks = 0;
+
+        if (m_cleared) {
+            // already blank on screen, step over them; spaces only when shorter
+            // and they would not paint a background
+            if (m_bg || csi_length(n) < n)
+                cursor_forward(n);
+            else
+                m_buffer.append(n, ' ');
+            return;
+        }
+
+        // something else may be on screen there, overwrite with the default background
+        set_default_bg();
+        if (2 * csi_length(n) < n) {
+            erase_chars(n);
+            cursor_forward(n);
+        } else {
+            m_buffer.append(n, ' ');
+        }
+    }
+
+    void flush_skips() {
+        if (!m_skips)
+            return;
+        cursor_forward(m_skips);
+        m_skips = 0;
+    }
+
+    void put_unicode(char32_t codepoint) {
+        if (codepoint <= 0x7F) {
+            m_buffer += char(codepoint);
+        } else if (codepoint <= 0x7FF) {
+            m_buffer += char(0xC0 | ((codepoint >> 6) & 0x1F));
+            m_buffer += char(0x80 | (codepoint & 0x3F));
+        } else if (codepoint <= 0xFFFF) {
+            m_buffer += char(0xE0 | ((codepoint >> 12) & 0x0F));
+            m_buffer += char(0x80 | ((codepoint >> 6) & 0x3F));
+            m_buffer += char(0x80 | (codepoint & 0x3F));
+        } else if (codepoint <= 0x10FFFF) {
+            m_buffer += char(0xF0 | ((codepoint >> 18) & 0x07));
+            m_buffer += char(0x80 | ((codepoint >> 12) & 0x3F));
+            m_buffer += char(0x80 | ((codepoint >> 6) & 0x3F));
+            m_buffer += char(0x80 | (codepoint & 0x3F));
+        }
+    }
+
+public:
+    explicit Encoder(const EncoderOptions &options = {})
+    : m_options(options) { }
+
+    const EncoderOptions& options() const { return m_options; }
+    const std::string& buffer() const { return m_buffer; }
+    size_t size() const { return m_buffer.size(); }
+    // mid-frame, after the buffer was written out: carry on into an empty one
+    void drain() { m_buffer.clear(); }
+
+    // start a new frame in an empty buffer, clear=false leaves the old frame up
+    // and overwrites it cell for cell
+    void begin_frame(bool clear = true) {
+        m_buffer.clear();
+        m_blanks = 0;
+        m_skips = 0;
+        m_cleared = clear;
+        if (m_options.synchronized)
+            m_buffer += TERM_SYNC_BEGIN;
+        if (clear)
+            m_buffer += TERM_CLEAR_SCREEN;
+        m_buffer += TERM_GOTO_TOP_LEFT;
+    }
+
+    // right after begin_frame(clear=false): move what the terminal shows in the
+    // frame's width x height cells up by rows (down if negative) and left by
+    // columns (right if negative), blanks moving in behind; the frame's rows are
+    // the scroll region so what is below it stays, columns need DECSLRM
+    void scroll(int rows, int columns, unsigned width, unsigned height) {
+        if (!rows && !columns)
+            return;
+        m_buffer += TERM_CSI "1;";
+        put_uint(height);
+        m_buffer += 'r';
+        if (rows) {
+            m_buffer += TERM_CSI;
+            put_uint(unsigned(std::abs(rows)));
+            m_buffer += rows > 0 ? 'S' : 'T';
+        }
+        if (columns) {
+            m_buffer += TERM_LR_MARGINS_ON TERM_CSI "1;";
+            put_uint(width);
+            m_buffer += 's';
+            m_buffer += TERM_CSI;
+            put_uint(unsigned(std::abs(columns)));
+            m_buffer += columns > 0 ? " @" : " A";
+            m_buffer += TERM_LR_MARGINS_OFF;
+        }
+        // setting the region moved the cursor, back to where the frame starts
+        m_buffer += TERM_CSI "r" TERM_GOTO_TOP_LEFT;
+    }
+
+    // leave the terminal with default colors, but only if it isn't already
+    void end_frame() {
+        m_blanks = 0;
+        m_skips = 0;
+        if (m_fg || m_bg)
+            m_buffer += TERM_COLOR_RESET;
+        m_fg = m_bg = m_next_fg = m_next_bg = {};
+        if (m_options.synchronized)
+            m_buffer += TERM_SYNC_END;
+    }
+
+    // colors for the next glyph, only sent if they differ from the terminal's
+    void fg(color24 c) { m_next_fg = c; }
+    void bg(color24 c) { m_next_bg = c; }
+
+    // an empty cell with the default background
+    void blank() {
+        flush_skips();
+        m_blanks ++;
+    }
+
+    // a cell the terminal already shows correctly, left untouched
+    void skip() {
+        flush_blanks();
+        m_skips ++;
+    }
+
+    void glyph(char32_t codepoint) {
+        flush_blanks();
+        flush_skips();
+        flush_colors();
+        put_unicode(codepoint);
+    }
+
+    // at the start of a row: move to the start of the frame's given row, from
+    // 0, instead of walking down the rows in between
+    void goto_row(unsigned row) {
+        m_buffer += TERM_CSI;
+        put_uint(row + 1);
+        m_buffer += 'H';
+    }
+
+    // finish a row, trailing blanks become nothing or an erase to end of line,
+    // trailing skips become nothing
+    void end_row() {
+        if (m_blanks && !m_cleared) {
+            set_default_bg();
+            m_buffer += TERM_ERASE_LINE;
+        }
+        m_blanks = 0;
+        m_skips = 0;
+        m_buffer += '\n';
+    }
+};
+
+}
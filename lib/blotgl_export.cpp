@@ -0,0 +1,269 @@
+#define GL_GLEXT_PROTOTYPES
+#include "blotgl_app.hpp"
+#include "blotgl_frame.hpp"
+#include "blotgl_glerror.hpp"
+#include "blotgl_gl_state.hpp"
+#include "blotgl_pixel_layer.hpp"
+#include "blotgl_shader.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Offline export renders a fixed range of frames as fast as it can, instead of
+// in real time.  Each worker thread has its own GL context (sharing objects with
+// the main one, the programs the main one's layers linked among them, see
+// ProgramCache), its own instances of the layers and its own framebuffer, and
+// renders, reads back, converts and encodes whole frames.  Timestamps come from
+// the frame index, and layers show what their timestamp says (see
+// Layer::on_update()) however many frames they skipped, so the output is the
+// same no matter how the frames got split up.  The main thread writes frames
+// to the file in order as they complete.
+// Without GL the workers have no context, and only run pixel layers.
+
+namespace BlotGL {
+
+struct App::ExportQueue {
+    std::mutex mutex;
+    std::condition_variable cond;
+    unsigned frames{};      // how many to render
+    unsigned window{};      // how far workers may run ahead of the writer
+    unsigned next{};        // next frame to hand out to a worker
+    unsigned written{};     // frames written to the file
+    bool stop{};
+    bool failed{};
+    std::map<unsigned,std::string> done;    // encoded, waiting for their turn
+};
+
+template <typename CELL>
+void App::export_worker(ExportQueue &queue, EGLContext ctx) const
+{
+    auto fail = [&queue] {
+        std::lock_guard lock(queue.mutex);
+        queue.failed = queue.stop = true;
+        queue.cond.notify_all();
+    };
+
+    const bool gl = ctx != EGL_NO_CONTEXT;
+    if (gl && !eglMakeCurrent(m_dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx)) {
+        fprintf(stderr, "eglMakeCurrent failed in export worker\n");
+        fail();
+        return;
+    }
+
+    // framebuffers and vertex arrays are not shared between contexts, so each
+    // worker needs its own, and its own layers to own them (and the buffers
+    // they fill per frame); the layers' programs are the ones m_ctx linked
+    GLuint fbo{}, rb{};
+    if (gl) {
+        GLState::current().reset();
+        Shader::share_programs(m_programs.get());
+        GL(glGenFramebuffers(1, &fbo));
+        GLState::current().bind_framebuffer(GL_FRAMEBUFFER, fbo);
+        GL(glGenRenderbuffers(1, &rb));
+        GL(glBindRenderbuffer(GL_RENDERBUFFER, rb));
+        GL(glRenderbufferStorage(GL_RENDERBUFFER, GL_RGB8, m_width, m_height));
+        GL(glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, rb));
+    }
+
+    // pixel layers run on this thread alone, the workers already keep every core busy
+    std::vector<std::unique_ptr<Layer>> layers;
+    std::vector<std::unique_ptr<PixelLayer>> pixel_layers;
+    try {
+        for (const auto &factory : m_layer_factories) {
+            auto layer = factory.create();
+            layer->set_view(factory.view);
+            if (factory.pixels)
+                pixel_layers.emplace_back(static_cast<PixelLayer*>(layer.release()));
+            else
+                layers.push_back(std::move(layer));
+        }
+    } catch (const std::exception &ex) {
+        fprintf(stderr, "export worker: %s\n", ex.what());
+        fail();
+    }
+
+    if (gl && glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        fprintf(stderr, "Framebuffer incomplete in export worker\n");
+        fail();
+    }
+
+    if (blotgl_drain_glerrors())
+        fail();
+
+    FrameArena arena;
+    Encoder encoder(m_encoder.options());
+
+    for (;;) {
+        unsigned index;
+        {
+            std::unique_lock lock(queue.mutex);
+            queue.cond.wait(lock, [&queue] {
+                return queue.stop || queue.next >= queue.frames
+                    || queue.next < queue.written + queue.window;
+            });
+            if (queue.stop || queue.next >= queue.frames)
+                break;
+            index = queue.next ++;
+        }
+
+        float timestamp = float(index / m_config.export_fps);
+
+        Frame<CELL> frame(m_width, m_height, arena);
+        if (gl) {
+            GLState::current().bind_framebuffer(GL_FRAMEBUFFER, fbo);
+            draw_layers(layers, m_width, m_height, timestamp);
+            GL(glReadPixels(0, 0, m_width, m_height, GL_RGB, GL_UNSIGNED_BYTE, frame.pixels()));
+        }
+        else
+            frame.pixel_reset();
+
+        if (!pixel_layers.empty()) {
+            update_pixel_layers(pixel_layers, timestamp);
+            render_pixel_layers(pixel_layers, frame.pixels(), 0, m_height, nullptr);
+        }
+
+        frame.pixels_to_cells(true);
+        frame.encode(encoder);
+
+        if (blotgl_drain_glerrors()) {
+            fail();
+            break;
+        }
+
+        {
+            std::lock_guard lock(queue.mutex);
+            queue.done.emplace(index, encoder.buffer());
+        }
+        queue.cond.notify_all();
+    }
+
+    layers.clear();
+    pixel_layers.clear();
+    if (!gl)
+        return;
+    Shader::share_programs(nullptr);
+    glDeleteRenderbuffers(1, &rb);
+    GLState::current().delete_framebuffers(1, &fbo);
+    eglMakeCurrent(m_dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+}
+
+int App::run_export()
+{
+    const auto &path = m_config.export_path;
+    unsigned frames = m_config.export_frames;
+
+    if (m_config.export_fps <= 0) {
+        fmt::println(stderr, "BLOTGL_EXPORT_FPS must be positive");
+        return 1;
+    }
+    auto exportable = [](const auto &layer) { return layer->exportable(); };
+    if (!std::all_of(m_layers.begin(), m_layers.end(), exportable)
+            || !std::all_of(m_pixel_layers.begin(), m_pixel_layers.end(), exportable)) {
+        fmt::println(stderr, "export: a layer can't be exported");
+        return 1;
+    }
+
+    FILE *file = fopen(path.c_str(), "wb");
+    if (!file) {
+        fmt::println(stderr, "Failed to open {}: {}", path, strerror(errno));
+        return 1;
+    }
+
+    unsigned threads = m_config.export_threads;
+    if (!threads)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::clamp(threads, 1u, std::max(1u, frames));
+
+    // without GL, workers get no context
+    std::vector<EGLContext> contexts;
+    for (unsigned i = 0; i < threads; i++) {
+        if (!gl()) {
+            contexts.push_back(EGL_NO_CONTEXT);
+            continue;
+        }
+        EGLContext ctx = create_context(m_ctx);
+        if (ctx == EGL_NO_CONTEXT)
+            break;
+        contexts.push_back(ctx);
+    }
+    if (contexts.empty()) {
+        fprintf(stderr, "eglCreateContext failed for export\n");
+        fclose(file);
+        return 1;
+    }
+    if (contexts.size() < threads)
+        fmt::println(stderr, "export: only {} of {} contexts could be created", contexts.size(), threads);
+
+    ExportQueue queue;
+    queue.frames = frames;
+    queue.window = 2 * contexts.size();
+
+    auto start_time = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+    dispatch_cell_encoding(m_config.encoding, [&]<typename CELL>() {
+        for (EGLContext ctx : contexts)
+            workers.emplace_back([this, &queue, ctx] { export_worker<CELL>(queue, ctx); });
+    });
+
+    size_t bytes{};
+    std::unique_lock lock(queue.mutex);
+    while (queue.written < frames && !queue.stop) {
+        auto it = queue.done.find(queue.written);
+        if (it == queue.done.end()) {
+            queue.cond.wait(lock);
+            continue;
+        }
+        std::string out = std::move(it->second);
+        queue.done.erase(it);
+        lock.unlock();
+
+        if (std::fwrite(out.data(), 1, out.size(), file) != out.size()) {
+            fmt::println(stderr, "Failed to write {}: {}", path, strerror(errno));
+            lock.lock();
+            queue.failed = queue.stop = true;
+            break;
+        }
+        bytes += out.size();
+
+        auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+        lock.lock();
+        queue.written ++;
+        if (g_interrupted)
+            queue.failed = queue.stop = true;
+        queue.cond.notify_all();
+
+        fmt::print("export: {}/{} frames {:.2f} FPS\r", queue.written, frames,
+                   elapsed ? queue.written / elapsed : 0.0);
+        std::flush(std::cout);
+    }
+    queue.stop = true;
+    bool failed = queue.failed;
+    unsigned written = queue.written;
+    lock.unlock();
+    queue.cond.notify_all();
+
+    for (auto &worker : workers)
+        worker.join();
+    for (EGLContext ctx : contexts) {
+        if (ctx != EGL_NO_CONTEXT)
+            eglDestroyContext(m_dpy, ctx);
+    }
+    fclose(file);
+
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    fmt::println("export: {} frames of {}x{} to {} in {:.2f}s ({:.2f} FPS, {} threads, {:.1f} KiB/frame)",
+                 written, m_width, m_height, path, elapsed, elapsed ? written / elapsed : 0.0,
+                 contexts.size(), written ? bytes / 1024.0 / written : 0.0);
+
+    return failed ? 1 : 0;
+}
+
+}
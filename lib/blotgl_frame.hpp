@@ -1,194 +1,562 @@
 #pragma once
 #include <cassert>
 #include <ostream>
-#include <vector>
+#include <memory>
 #include <cstdint>
+#include <type_traits>
 #include <fmt/core.h>
 #include <fmt/ostream.h>
 
 #include "blotgl_braille.hpp"
+#include "blotgl_cell.hpp"
 #include "blotgl_utils.hpp"
 #include "blotgl_color.hpp"
 #include "blotgl_terminal.hpp"
+#include "blotgl_encoder.hpp"
+#include "blotgl_screen.hpp"
+#include "blotgl_arena.hpp"
+#include "blotgl_view.hpp"
+#include "blotgl_kernels.hpp"
 
 namespace BlotGL {
 
 template <
-size_t BPP = 3, // input pixel size, only 3 bit-per-pixel is supported right now
-bool AVGPXL = true  // enable averaging of pixel colors into final braille color
+typename CELL = BrailleCell, // cell geometry and glyph mapping, see blotgl_cell.hpp
+size_t BPP = 3, // input pixel size in bytes: 3 for RGB, 4 for RGBX (the X is ignored)
+bool AVGPXL = true  // enable averaging of pixel colors into final cell color
 >
 class Frame final {
 public:
     using Size = uint32_t;
+    using Cell = CELL;
+    using CellData = std::conditional_t<CELL::BACKGROUND, PackedCellBg, PackedCell>;
 
+    // buffers live in the given arena, which is reset; reusing one arena across
+    // frames of the same size keeps the memory (and its contents) in place
+    Frame(Size width, Size height, FrameArena &arena)
+    : m_width(width), m_height(height), m_stride(size_t(width) * BPP),
+      m_kernels(&frame_kernels<Frame>()) {
+        allocate(arena);
+    }
+    // pixels are somewhere else already, stride bytes from one row to the next;
+    // only the cells live in the arena
+    Frame(Size width, Size height, FrameArena &arena, uint8_t *pixels, size_t stride)
+    : m_width(width), m_height(height), m_stride(stride),
+      m_kernels(&frame_kernels<Frame>()) {
+        arena.reset();
+        arena.reserve(FrameArena::footprint({ cell_size() * sizeof(CellData) }));
+        m_pixels = pixels;
+        m_cells = arena.allocate<CellData>(cell_size());
+    }
+    // buffers live in an arena of the frame's own
     Frame(Size width, Size height)
-    : m_width(width), m_height(height),
-      m_pixels(pixel_size() * BPP, 0),
-      m_braille(braille_size(), 0),
-      m_colors(braille_size(), color24{}) { }
+    : m_width(width), m_height(height), m_stride(size_t(width) * BPP),
+      m_kernels(&frame_kernels<Frame>()),
+      m_own_arena(std::make_unique<FrameArena>()) {
+        allocate(*m_own_arena);
+    }
     ~Frame() = default;
 
+    Frame(const Frame&) = delete;
+    Frame& operator=(const Frame&) = delete;
+
+    // bytes of arena a frame of this size occupies
+    static constexpr size_t footprint(Size width, Size height) {
+        size_t cells = size_t(div_round_up(width, Size(CELL::COLS)))
+                     * size_t(div_round_up(height, Size(CELL::ROWS)));
+        return FrameArena::footprint({ size_t(width) * height * BPP, cells * sizeof(CellData) });
+    }
+
     // RGB pixel buffer
 
     Size pixel_width() const { return m_width; }
     Size pixel_height() const { return m_height; }
     size_t pixel_size() const { return size_t(pixel_width()) * size_t(pixel_height()); }
-    uint8_t* pixels() { return m_pixels.data(); }
+    uint8_t* pixels() { return m_pixels; }
+    size_t pixel_stride() const { return m_stride; }
     uint8_t* pixel_ptr(Size x, Size y) {
-        size_t index = pixel_index(x, y);
-        return pixels() + (index * BPP);
+        assert (x < m_width);
+        return pixels() + pixel_offset(y) + size_t(x) * BPP;
     }
     color24 pixel_color(Size x, Size y) {
-        static_assert(BPP == 3); // only this is supported for now
+        static_assert(BPP == 3 || BPP == 4);
         const uint8_t *rgb = pixel_ptr(x, y);
         return { rgb[0], rgb[1], rgb[2] };
     }
 
     void pixel_reset() {
-        std::fill(m_pixels.begin(), m_pixels.end(), 0);
+        for (Size y=0; y<m_height; y++)
+            std::fill_n(m_pixels + pixel_offset(y), size_t(m_width) * BPP, 0);
+    }
+
+    // cell buffer: a CELL::bit_at() glyph mask and its colors, packed per character
+
+    Size cell_width() const { return div_round_up(m_width, Size(CELL::COLS)); }
+    Size cell_height() const { return div_round_up(m_height, Size(CELL::ROWS)); }
+    size_t cell_size() const { return size_t(cell_width()) * size_t(cell_height()); }
+    CellData* cells() { return m_cells; }
+    CellData& cell(Size x, Size y) {
+        size_t index = cell_index(x, y);
+        return cells()[index];
+    }
+    uint8_t& glyph(Size x, Size y) { return cell(x, y).glyph; }
+    color24& color(Size x, Size y) { return cell(x, y).fg; }
+    color24& bg_color(Size x, Size y) {
+        static_assert(CELL::BACKGROUND);
+        return cell(x, y).bg;
     }
 
-    // braille glyph buffer
+    void cell_reset() {
+        std::fill(m_cells, m_cells + cell_size(), CellData{});
+    }
 
-    Size braille_width() const { return div_round_up(m_width, BlotGL::BRAILLE_GLYPH_COLS); }
-    Size braille_height() const { return div_round_up(m_height, BlotGL::BRAILLE_GLYPH_ROWS); }
-    size_t braille_size() const { return size_t(braille_width()) * size_t(braille_height()); }
-    uint8_t* braille() { return m_braille.data(); }
-    uint8_t& braille(Size x, Size y) {
-        size_t index = braille_index(x, y);
-        return braille()[index];
+    // arena memory is not cleared, buffers hold whatever was there until written
+    void reset() {
+        pixel_reset();
+        cell_reset();
     }
 
-    void braille_reset() {
-        std::fill(m_braille.begin(), m_braille.end(), 0);
+    // instruction set the conversion and encoding run with
+    Isa isa() const { return m_kernels->isa; }
+
+    // convert pixel buffer to glyphs/colors, every cell is overwritten
+    void pixels_to_cells(bool invert_y_axis) {
+        m_kernels->convert(*this, invert_y_axis, { 0, 0, cell_width(), cell_height() });
     }
 
-    // color buffer (same size as braille character buffer)
+    // only convert the tiles of tile_cols x tile_rows cells that dirty(column, row)
+    // says changed, the other cells keep what an earlier frame left in them
+    template <typename DIRTY>
+    void pixels_to_cells(bool invert_y_axis, Size tile_cols, Size tile_rows, DIRTY &&dirty) {
+        for (Size cy=0, row=0; cy<cell_height(); cy+=tile_rows, row++) {
+            for (Size cx=0, column=0; cx<cell_width(); cx+=tile_cols, column++) {
+                if (dirty(column, row))
+                    m_kernels->convert(*this, invert_y_axis, { cx, cy, tile_cols, tile_rows });
+            }
+        }
+    }
 
-    color24* colors() { return m_colors.data(); }
-    color24& color(Size x, Size y) {
-        size_t index = braille_index(x, y);
-        return colors()[index];
+    // only convert cell rows begin..end, the others keep what they had
+    void pixels_to_cells(bool invert_y_axis, Size begin_row, Size end_row) {
+        if (begin_row < end_row)
+            m_kernels->convert(*this, invert_y_axis, { 0, begin_row, cell_width(), end_row - begin_row });
     }
 
-    void color_reset() {
-        std::fill(m_colors.begin(), m_colors.end(), color24{});
+    // only convert the cells inside rects, the others keep what they had
+    void pixels_to_cells(bool invert_y_axis, const std::vector<CellRect> &rects) {
+        for (const CellRect &rect : rects)
+            m_kernels->convert(*this, invert_y_axis, rect);
     }
 
-    void reset() {
-        pixel_reset();
-        braille_reset();
-        color_reset();
+    // emit a whole frame of cells
+    void encode(Encoder &enc, bool clear = true) {
+        enc.begin_frame(clear);
+        m_kernels->encode(*this, enc, nullptr, nullptr, 0, cell_height());
+        enc.end_frame();
     }
 
-    // convert pixel buffer to braille/colors
-    void pixels_to_braille(bool invert_y_axis) {
-        for (size_t y=0; y<m_height; y++) {
-            for (size_t x=0; x<m_width; x++) {
-                color24 pix = invert_y_axis ? pixel_color(x,m_height-y-1) : pixel_color(x,y);
-                if (!pix)
-                    continue;
+    // emit the cells inside rects over what the terminal shows, skipping the rest
+    void encode(Encoder &enc, const std::vector<CellRect> &rects) {
+        enc.begin_frame(false);
+        m_kernels->encode(*this, enc, nullptr, &rects, 0, cell_height());
+        enc.end_frame();
+    }
 
-                // locate in braille array
-                Size bx = x/BRAILLE_GLYPH_COLS;
-                Size by = y/BRAILLE_GLYPH_ROWS;
-                auto &b = braille(bx, by);
-                auto &c = color(bx, by);
+    // only send the cells that differ from what the screen shows, of those inside rects if given
+    // and first scroll the terminal if it shows this frame shifted, unless limited to rects
+    void encode(Encoder &enc, Screen &screen, const std::vector<CellRect> *rects = nullptr) {
+        bool clear = screen.begin_frame(cell_width(), cell_height());
+        enc.begin_frame(clear);
+        if (!clear && !rects)
+            scroll(enc, screen);
+        m_kernels->encode(*this, enc, &screen, rects, 0, cell_height());
+        enc.end_frame();
+    }
 
-                // locate within braille 2x4 glyph
-                Size gx = x%BlotGL::BRAILLE_GLYPH_COLS;
-                Size gy = y%BlotGL::BRAILLE_GLYPH_ROWS;
-                uint8_t g = braille_glyph_at(gx, gy);
+    // the same a band of cell rows at a time, as they become ready: begin_encode(),
+    // then encode_rows() for every band from the top down, then end_encode();
+    // never scrolls, as the rows below aren't known when the first are sent
+    void begin_encode(Encoder &enc, bool clear = true) {
+        enc.begin_frame(clear);
+    }
+    void begin_encode(Encoder &enc, Screen &screen) {
+        enc.begin_frame(screen.begin_frame(cell_width(), cell_height()));
+    }
+    void encode_rows(Encoder &enc, Size begin_row, Size end_row, Screen *screen = nullptr) {
+        m_kernels->encode(*this, enc, screen, nullptr, begin_row, std::min(end_row, cell_height()));
+    }
+    void end_encode(Encoder &enc) {
+        enc.end_frame();
+    }
 
-                b += g;
-                c = pix;
+    // hash every row and column of cells as the screen would record them, and
+    // if they line up with what it shows moved, scroll that into place
+    void scroll(Encoder &enc, Screen &screen) {
+        if (!screen.options().scroll)
+            return;
+        std::vector<uint64_t> rows(cell_height(), Screen::HASH_SEED);
+        std::vector<uint64_t> columns(cell_width(), Screen::HASH_SEED);
+        for (Size y=0; y<cell_height(); y++) {
+            for (Size x=0; x<cell_width(); x++) {
+                uint8_t g = glyph(x, y);
+                color24 fg = g ? color(x, y) : color24{};
+                color24 bg{};
+                if constexpr (CELL::BACKGROUND) {
+                    if (!covers_background(g))
+                        bg = bg_color(x, y);
+                }
+                rows[y] = Screen::hash(rows[y], g, fg, bg);
+                columns[x] = Screen::hash(columns[x], g, fg, bg);
             }
         }
+
+        ScrollShift shift = screen.find_scroll(rows, columns);
+        if (!shift)
+            return;
+        enc.scroll(shift.rows, shift.columns, cell_width(), cell_height());
+        screen.scroll(shift);
     }
 
-    std::ostream & braille_to_stream(std::ostream &out) {
-        gen_clear_screen(out);
-        gen_top_left(out);
-        for (size_t y=0; y<braille_height(); y++) {
-            color24 prev_color{};
-            for (size_t x=0; x<braille_width(); x++) {
-                uint8_t g = braille(x, y);
-                if (!g) {
-                    out << ' ';
-                    continue;
-                }
+    // the work itself, run through the kernels built for this CPU (see
+    // blotgl_kernels.hpp) rather than called directly
+
+    // convert the cells inside rect, clipped to the frame
+    void convert_cells(bool invert_y_axis, const CellRect &rect) {
+        Size end_x = std::min(rect.x + rect.width, cell_width());
+        Size end_y = std::min(rect.y + rect.height, cell_height());
+        for (Size cy=rect.y; cy<end_y; cy++)
+            convert_row(invert_y_axis, cy, rect.x, end_x);
+    }
 
-                color24 c = color(x, y);
-                if (prev_color != c) {
-                    prev_color = c;
-                    gen_color(out, c);
+    // rows begin..end, one foreground color per cell, unlit cells are blank;
+    // with rects, cells outside them are skipped
+    void encode_range(Encoder &enc, Screen *screen, const std::vector<CellRect> *rects,
+                      Size begin, Size end) {
+        std::vector<uint8_t> inside;
+        Size next = begin;      // row the cursor is at the start of
+        for (Size y=begin; y<end; y++) {
+            const uint8_t *mask = nullptr;
+            if (rects) {
+                inside.assign(cell_width(), 0);
+                bool any = false;
+                for (const CellRect &rect : *rects) {
+                    if (y >= rect.y && y < rect.y + rect.height) {
+                        Size end = std::min(rect.x + rect.width, cell_width());
+                        std::fill(inside.begin() + std::min(rect.x, end), inside.begin() + end, 1);
+                        any = any || rect.x < end;
+                    }
                 }
-                gen_unicode(out, BRAILLE_GLYPH_BASE + g);
+                // rows outside every rect are jumped over, not walked
+                if (!any)
+                    continue;
+                if (y != next)
+                    enc.goto_row(y);
+                mask = inside.data();
             }
-            if (prev_color)
-                gen_reset(out);
-
-            out << '\n';
+            if constexpr (CELL::BACKGROUND)
+                encode_row_fgbg(enc, y, screen, mask);
+            else
+                encode_row_fg(enc, y, screen, mask);
+            enc.end_row();
+            next = y + 1;
         }
-        return out;
     }
 
-
 protected:
     const Size m_width;
     const Size m_height;
-    std::vector<uint8_t> m_pixels;   // input from OpenGL, 24 bits per viewport pixel
-    std::vector<uint8_t> m_braille;  // output braille codepoint for each character (8 pixels)
-    std::vector<color24> m_colors;   // output braille color for each character (8 pixels)
+    const size_t m_stride;    // bytes from one pixel row to the next
+    const FrameKernels<Frame> *m_kernels;
+    std::unique_ptr<FrameArena> m_own_arena;
+    uint8_t *m_pixels{};      // input from OpenGL, BPP bytes per viewport pixel
+    CellData *m_cells{};      // output glyph mask and colors for each character (CELL::COLS x CELL::ROWS pixels)
+
+    void allocate(FrameArena &arena) {
+        arena.reset();
+        arena.reserve(footprint(m_width, m_height));
+        m_pixels = arena.allocate<uint8_t>(pixel_size() * BPP);
+        m_cells = arena.allocate<CellData>(cell_size());
+    }
 
     static constexpr size_t buffer_size(size_t width, size_t height) {
         return width * height * BPP;
     }
-    constexpr size_t pixel_index(size_t x, size_t y) {
-        assert (x < m_width);
+    size_t pixel_offset(size_t y) const {
         assert (y < m_height);
-        return x + (y * m_width);
-    }
-    constexpr size_t braille_index(size_t x, size_t y) {
-        assert (x < braille_width());
-        assert (y < braille_height());
-        return x + (y * braille_width());
-    }
-    static constexpr uint8_t braille_glyph_at(uint8_t x, uint8_t y) {
-        assert (x < BRAILLE_GLYPH_COLS);
-        assert (y < BRAILLE_GLYPH_ROWS);
-        size_t index = x + (y*BRAILLE_GLYPH_COLS);
-        return BlotGL::braille_mapping[index];
-    }
-    static constexpr void gen_unicode(std::ostream &out, char32_t codepoint) {
-        if (codepoint <= 0x7F) {
-            out << char(codepoint);
-        } else if (codepoint <= 0x7FF) {
-            out << char(0xC0 | ((codepoint >> 6) & 0x1F))
-                << char(0x80 | (codepoint & 0x3F));
-        } else if (codepoint <= 0xFFFF) {
-            out << char(0xE0 | ((codepoint >> 12) & 0x0F))
-                << char(0x80 | ((codepoint >> 6) & 0x3F))
-                << char(0x80 | (codepoint & 0x3F));
-        } else if (codepoint <= 0x10FFFF) {
-            out << char(0xF0 | ((codepoint >> 18) & 0x07))
-                << char(0x80 | ((codepoint >> 12) & 0x3F))
-                << char(0x80 | ((codepoint >> 6) & 0x3F))
-                << char(0x80 | (codepoint & 0x3F));
+        return y * m_stride;
+    }
+    constexpr size_t cell_index(size_t x, size_t y) {
+        assert (x < cell_width());
+        assert (y < cell_height());
+        return x + (y * cell_width());
+    }
+    const uint8_t* pixel_row(Size y) {
+        return pixels() + pixel_offset(y);
+    }
+
+    // whether glyph mask g hides the background color, see CELL::SOLID
+    static constexpr bool covers_background(uint8_t g) {
+        constexpr uint8_t FULL = uint8_t((1u << (CELL::COLS * CELL::ROWS)) - 1);
+        if constexpr (CELL::BACKGROUND)
+            return CELL::SOLID && g == FULL;
+        return g == FULL;
+    }
+
+    // accumulates the lit pixels of one cell
+    struct CellAccumulator {
+        uint8_t mask{};
+        unsigned r{}, g{}, b{}, count{};
+        color24 last{};
+
+        void add(const uint8_t *rgb, uint8_t bit) {
+            if (!(rgb[0] | rgb[1] | rgb[2]))
+                return;
+            mask |= bit;
+            if constexpr (AVGPXL) {
+                r += rgb[0];
+                g += rgb[1];
+                b += rgb[2];
+                count ++;
+            } else {
+                last = { rgb[0], rgb[1], rgb[2] };
+            }
+        }
+        color24 color() const {
+            if constexpr (AVGPXL) {
+                if (!count)
+                    return {};
+                color24 c{ uint8_t(r / count), uint8_t(g / count), uint8_t(b / count) };
+                // lit dots that average down to black would be drawn in the
+                // terminal's default color, keep them the darkest there is
+                if (!c)
+                    c = { uint8_t(r != 0), uint8_t(g != 0), uint8_t(b != 0) };
+                return c;
+            } else {
+                return last;
+            }
         }
     };
 
-    static constexpr void gen_color(std::ostream &out, color24 color) {
-        out << std::format("\033[38;2;{};{};{}m", color.r, color.g, color.b);
-    };
-    static constexpr void gen_reset(std::ostream &out) {
-        out << TERM_COLOR_RESET;
+    // convert cells begin..end of one row of cells
+    void convert_row(bool invert_y_axis, Size cy, Size begin, Size end) {
+        // pixel rows that make up this row of cells, clipped at the bottom edge
+        std::array<const uint8_t*, CELL::ROWS> rows{};
+        for (Size gy=0; gy<CELL::ROWS; gy++) {
+            Size y = cy * CELL::ROWS + gy;
+            if (y >= m_height)
+                break;
+            rows[gy] = pixel_row(invert_y_axis ? m_height-y-1 : y);
+        }
+
+        if constexpr (CELL::BACKGROUND && CELL::COLS * CELL::ROWS > 2) {
+            split_cells(rows, cy, begin, end);
+        } else {
+            Size full = std::min(end, Size(m_width / CELL::COLS));
+            if (cy * CELL::ROWS + CELL::ROWS > m_height)
+                full = 0;   // last row is partial, take the clipped path for all of it
+
+            Size cx = begin;
+            for (; cx<full; cx++)
+                convert_cell<false>(rows, cx, cy);
+            for (; cx<end; cx++)
+                convert_cell<true>(rows, cx, cy);
+        }
+    }
+
+    template <bool CLIPPED>
+    void convert_cell(const std::array<const uint8_t*, CELL::ROWS> &rows, Size cx, Size cy) {
+        size_t index = cell_index(cx, cy);
+
+        if constexpr (CELL::BACKGROUND) {
+            // two pixels, each its own color, need no splitting (the others go
+            // through split_cells()): the mask says which is drawn in the foreground
+            // color, the other shows the background (black is the terminal's own)
+            static_assert(CELL::COLS * CELL::ROWS == 2);
+            const uint8_t *top = rows[0] + size_t(cx) * BPP;
+            color24 upper{ top[0], top[1], top[2] };
+            color24 lower{};
+            if (!CLIPPED || rows[1]) {
+                const uint8_t *bottom = rows[1] + size_t(cx) * BPP;
+                lower = { bottom[0], bottom[1], bottom[2] };
+            }
+            uint8_t mask;
+            color24 fg, bg;
+            if (upper == lower) {
+                mask = upper ? CELL::bit_at(0,0) | CELL::bit_at(0,1) : 0;
+                fg = upper;
+            } else if (upper) {
+                mask = CELL::bit_at(0,0);
+                fg = upper;
+                bg = lower;
+            } else {
+                mask = CELL::bit_at(0,1);
+                fg = lower;
+            }
+            CellData::store(&m_cells[index], fg, mask, bg);
+
+        } else {
+            CellAccumulator acc;
+            for (Size gy=0; gy<CELL::ROWS; gy++) {
+                if (CLIPPED && !rows[gy])
+                    break;
+                for (Size gx=0; gx<CELL::COLS; gx++) {
+                    Size x = cx * CELL::COLS + gx;
+                    if (CLIPPED && x >= m_width)
+                        break;
+                    acc.add(rows[gy] + size_t(x) * BPP, CELL::bit_at(gx, gy));
+                }
+            }
+            CellData::store(&m_cells[index], acc.color(), acc.mask);
+        }
+    }
+
+    // cells begin..end of a row of a two color policy, SPLIT_LANES of them at a
+    // time with each step running across those cells rather than within one, so
+    // it vectorizes: a cell's pixels are split by luma at its mean, then split
+    // again halfway between the mean lumas of the two sides (one step of
+    // 2-means), and each side is averaged into a color.  The brighter side is
+    // the foreground and lights the dots, a cell all one luma is background
+    // only.  Pixels past the frame's edges repeat the last ones inside.
+    static constexpr Size SPLIT_LANES = 16;
+
+    void split_cells(std::array<const uint8_t*, CELL::ROWS> rows, Size cy, Size begin, Size end) {
+        constexpr size_t P = CELL::COLS * CELL::ROWS;
+        constexpr Size L = SPLIT_LANES;
+        static constexpr auto BITS = [] {
+            std::array<uint8_t, P> bits{};
+            for (size_t p=0; p<P; p++)
+                bits[p] = CELL::bit_at(p % CELL::COLS, p / CELL::COLS);
+            return bits;
+        }();
+
+        for (Size gy=1; gy<CELL::ROWS; gy++) {
+            if (!rows[gy])
+                rows[gy] = rows[gy-1];
+        }
+
+        for (Size cx=begin; cx<end; cx+=L) {
+            Size n = std::min(end - cx, L);
+
+            // the cells' pixels by their position in the cell, then cell
+            uint16_t r[P][L]{}, g[P][L]{}, b[P][L]{}, luma[P][L]{};
+            for (size_t p=0; p<P; p++) {
+                const uint8_t *row = rows[p / CELL::COLS];
+                for (Size l=0; l<n; l++) {
+                    Size x = std::min(Size((cx + l) * CELL::COLS + p % CELL::COLS), m_width - 1);
+                    const uint8_t *rgb = row + size_t(x) * BPP;
+                    r[p][l] = rgb[0];
+                    g[p][l] = rgb[1];
+                    b[p][l] = rgb[2];
+                }
+            }
+
+            uint16_t sum[L]{};
+            for (size_t p=0; p<P; p++) {
+                for (size_t l=0; l<L; l++) {
+                    luma[p][l] = uint16_t((77 * r[p][l] + 150 * g[p][l] + 29 * b[p][l]) >> 8);
+                    sum[l] += luma[p][l];
+                }
+            }
+
+            // above the mean
+            uint16_t upper_sum[L]{}, upper_count[L]{};
+            for (size_t p=0; p<P; p++) {
+                for (size_t l=0; l<L; l++) {
+                    uint16_t upper = luma[p][l] * P > sum[l];
+                    upper_sum[l] += upper * luma[p][l];
+                    upper_count[l] += upper;
+                }
+            }
+
+            // above halfway between the means of both sides, multiplied out so
+            // nothing is divided: 2 luma > upper_sum / upper_count + lower_sum / lower_count;
+            // both sides are at most 2 * 255 * upper_count * lower_count, 16 bits hold them
+            uint8_t mask[L]{};
+            uint16_t fg_r[L]{}, fg_g[L]{}, fg_b[L]{}, fg_count[L]{};
+            uint16_t all_r[L]{}, all_g[L]{}, all_b[L]{};
+            for (size_t p=0; p<P; p++) {
+                for (size_t l=0; l<L; l++) {
+                    uint16_t lower_count = uint16_t(P - upper_count[l]);
+                    uint16_t lower_sum = uint16_t(sum[l] - upper_sum[l]);
+                    uint16_t upper = uint16_t(2 * luma[p][l] * upper_count[l] * lower_count)
+                                   > uint16_t(upper_sum[l] * lower_count + lower_sum * upper_count[l]);
+                    mask[l] |= uint8_t(upper * BITS[p]);
+                    fg_r[l] += upper * r[p][l];
+                    fg_g[l] += upper * g[p][l];
+                    fg_b[l] += upper * b[p][l];
+                    fg_count[l] += upper;
+                    all_r[l] += r[p][l];
+                    all_g[l] += g[p][l];
+                    all_b[l] += b[p][l];
+                }
+            }
+
+            // the averages, rounded, through reciprocals that divide all lanes at once
+            uint8_t fg_rgb[3][L], bg_rgb[3][L];
+            for (size_t l=0; l<L; l++) {
+                float fg_scale = fg_count[l] ? 1.0f / float(fg_count[l]) : 0.0f;
+                float bg_scale = 1.0f / float(P - fg_count[l]);    // never all foreground
+                fg_rgb[0][l] = uint8_t(float(fg_r[l]) * fg_scale + 0.5f);
+                fg_rgb[1][l] = uint8_t(float(fg_g[l]) * fg_scale + 0.5f);
+                fg_rgb[2][l] = uint8_t(float(fg_b[l]) * fg_scale + 0.5f);
+                bg_rgb[0][l] = uint8_t(float(all_r[l] - fg_r[l]) * bg_scale + 0.5f);
+                bg_rgb[1][l] = uint8_t(float(all_g[l] - fg_g[l]) * bg_scale + 0.5f);
+                bg_rgb[2][l] = uint8_t(float(all_b[l] - fg_b[l]) * bg_scale + 0.5f);
+            }
+
+            for (Size l=0; l<n; l++) {
+                CellData::store(&m_cells[cell_index(cx + l, cy)],
+                                { fg_rgb[0][l], fg_rgb[1][l], fg_rgb[2][l] }, mask[l],
+                                { bg_rgb[0][l], bg_rgb[1][l], bg_rgb[2][l] });
+            }
+        }
     }
-    static constexpr void gen_clear_screen(std::ostream &out) {
-        out << TERM_CLEAR_SCREEN;
+
+    void encode_row_fg(Encoder &enc, Size y, Screen *screen, const uint8_t *mask) {
+        for (Size x=0; x<cell_width(); x++) {
+            if (mask && !mask[x]) {
+                enc.skip();
+                continue;
+            }
+            uint8_t g = glyph(x, y);
+            if (screen && !screen->update(cell_index(x, y), g, g ? color(x, y) : color24{}, {})) {
+                enc.skip();
+                continue;
+            }
+            if (!g) {
+                enc.blank();
+                continue;
+            }
+            enc.fg(color(x, y));
+            enc.glyph(CELL::codepoint(g));
+        }
     }
-    static constexpr void gen_top_left(std::ostream &out) {
-        out << TERM_GOTO_TOP_LEFT;
+
+    // foreground for the masked pixels and background for the rest, black is the terminal's own
+    void encode_row_fgbg(Encoder &enc, Size y, Screen *screen, const uint8_t *mask) {
+        for (Size x=0; x<cell_width(); x++) {
+            if (mask && !mask[x]) {
+                enc.skip();
+                continue;
+            }
+            uint8_t g = glyph(x, y);
+            color24 bg = bg_color(x, y);
+            if (screen && !screen->update(cell_index(x, y), g, g ? color(x, y) : color24{},
+                                          covers_background(g) ? color24{} : bg)) {
+                enc.skip();
+                continue;
+            }
+            if (!g && !bg) {
+                enc.blank();
+                continue;
+            }
+            // a full solid glyph covers the background, leave it as it is
+            if (!covers_background(g))
+                enc.bg(bg);
+            if (g)
+                enc.fg(color(x, y));
+            enc.glyph(CELL::codepoint(g));
+        }
     }
 };
 
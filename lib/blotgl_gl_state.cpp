@@ -0,0 +1,263 @@
+#define GL_GLEXT_PROTOTYPES
+#include "blotgl_gl_state.hpp"
+#include "blotgl_glerror.hpp"
+
+#include <cstring>
+#include <bit>
+
+namespace BlotGL {
+
+GLState& GLState::current()
+{
+    // per thread, as each thread has its own GL context
+    static thread_local GLState state;
+    return state;
+}
+
+void GLState::reset()
+{
+    GLCallCounts counts = m_counts;
+    *this = GLState{};
+    m_counts = counts;
+}
+
+GLCallCounts GLState::take_counts()
+{
+    GLCallCounts counts = m_counts;
+    m_counts = {};
+    return counts;
+}
+
+bool GLState::change(GLuint &current, GLuint value)
+{
+    if (current == value) {
+        m_counts.skipped ++;
+        return false;
+    }
+    current = value;
+    m_counts.issued ++;
+    return true;
+}
+
+bool GLState::change_uniform(GLint location, const void *data, size_t bytes)
+{
+    // a location is only known in a known program
+    if (m_program == UNKNOWN || location < 0) {
+        m_counts.issued ++;
+        return true;
+    }
+    auto &value = m_uniforms[uint64_t(m_program) << 32 | uint32_t(location)];
+    if (value.size() * sizeof(uint32_t) == bytes && !std::memcmp(value.data(), data, bytes)) {
+        m_counts.skipped ++;
+        return false;
+    }
+    value.resize(bytes / sizeof(uint32_t));
+    std::memcpy(value.data(), data, bytes);
+    m_counts.issued ++;
+    return true;
+}
+
+GLuint* GLState::buffer_binding(GLenum target)
+{
+    switch (target) {
+    case GL_ARRAY_BUFFER: return &m_array_buffer;
+    case GL_PIXEL_PACK_BUFFER: return &m_pack_buffer;
+    case GL_PIXEL_UNPACK_BUFFER: return &m_unpack_buffer;
+    case GL_UNIFORM_BUFFER: return &m_uniform_buffer;
+    // element arrays belong to the vertex array, the rest aren't used
+    default: return nullptr;
+    }
+}
+
+void GLState::use_program(GLuint program)
+{
+    if (change(m_program, program))
+        GL(glUseProgram(program));
+}
+
+void GLState::bind_vertex_array(GLuint vertex_array)
+{
+    if (change(m_vertex_array, vertex_array))
+        GL(glBindVertexArray(vertex_array));
+}
+
+void GLState::bind_buffer(GLenum target, GLuint buffer)
+{
+    GLuint *binding = buffer_binding(target);
+    if (!binding) {
+        m_counts.issued ++;
+        GL(glBindBuffer(target, buffer));
+        return;
+    }
+    if (change(*binding, buffer))
+        GL(glBindBuffer(target, buffer));
+}
+
+void GLState::bind_buffer_range(GLenum target, GLuint index, GLuint buffer,
+                                GLintptr offset, GLsizeiptr size)
+{
+    // also binds the target as a whole
+    if (GLuint *binding = buffer_binding(target))
+        *binding = buffer;
+
+    if (target == GL_UNIFORM_BUFFER && index < UNIFORM_BINDINGS) {
+        Range &range = m_uniform_ranges[index];
+        if (range.buffer == buffer && range.offset == offset && range.size == size) {
+            m_counts.skipped ++;
+            return;
+        }
+        range = { buffer, offset, size };
+    }
+    m_counts.issued ++;
+    GL(glBindBufferRange(target, index, buffer, offset, size));
+}
+
+void GLState::bind_framebuffer(GLenum target, GLuint framebuffer)
+{
+    bool read = target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER;
+    bool draw = target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER;
+    if ((!read || m_read_framebuffer == framebuffer) && (!draw || m_draw_framebuffer == framebuffer)) {
+        m_counts.skipped ++;
+        return;
+    }
+    if (read)
+        m_read_framebuffer = framebuffer;
+    if (draw)
+        m_draw_framebuffer = framebuffer;
+    m_counts.issued ++;
+    GL(glBindFramebuffer(target, framebuffer));
+}
+
+GLuint GLState::draw_framebuffer()
+{
+    if (m_draw_framebuffer == UNKNOWN) {
+        GLint binding{};
+        GL(glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &binding));
+        m_draw_framebuffer = GLuint(binding);
+    }
+    return m_draw_framebuffer;
+}
+
+void GLState::viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    std::array<GLint, 4> value{ x, y, width, height };
+    if (m_viewport == value) {
+        m_counts.skipped ++;
+        return;
+    }
+    m_viewport = value;
+    m_counts.issued ++;
+    GL(glViewport(x, y, width, height));
+}
+
+void GLState::clear_color(GLfloat r, GLfloat g, GLfloat b, GLfloat a)
+{
+    std::array<uint32_t, 4> value{ std::bit_cast<uint32_t>(r), std::bit_cast<uint32_t>(g),
+                                   std::bit_cast<uint32_t>(b), std::bit_cast<uint32_t>(a) };
+    if (m_clear_color_known && m_clear_color == value) {
+        m_counts.skipped ++;
+        return;
+    }
+    m_clear_color = value;
+    m_clear_color_known = true;
+    m_counts.issued ++;
+    GL(glClearColor(r, g, b, a));
+}
+
+void GLState::uniform(GLint location, GLfloat x)
+{
+    if (change_uniform(location, &x, sizeof(x)))
+        GL(glUniform1f(location, x));
+}
+
+void GLState::uniform(GLint location, GLfloat x, GLfloat y)
+{
+    GLfloat v[] = { x, y };
+    if (change_uniform(location, v, sizeof(v)))
+        GL(glUniform2f(location, x, y));
+}
+
+void GLState::uniform(GLint location, GLfloat x, GLfloat y, GLfloat z)
+{
+    GLfloat v[] = { x, y, z };
+    if (change_uniform(location, v, sizeof(v)))
+        GL(glUniform3f(location, x, y, z));
+}
+
+void GLState::uniform(GLint location, GLfloat x, GLfloat y, GLfloat z, GLfloat w)
+{
+    GLfloat v[] = { x, y, z, w };
+    if (change_uniform(location, v, sizeof(v)))
+        GL(glUniform4f(location, x, y, z, w));
+}
+
+void GLState::uniform(GLint location, GLint x)
+{
+    if (change_uniform(location, &x, sizeof(x)))
+        GL(glUniform1i(location, x));
+}
+
+void GLState::uniform(GLint location, GLint x, GLint y)
+{
+    GLint v[] = { x, y };
+    if (change_uniform(location, v, sizeof(v)))
+        GL(glUniform2i(location, x, y));
+}
+
+void GLState::uniform3fv(GLint location, GLsizei count, const GLfloat *values)
+{
+    if (change_uniform(location, values, size_t(count) * 3 * sizeof(GLfloat)))
+        GL(glUniform3fv(location, count, values));
+}
+
+void GLState::delete_program(GLuint program)
+{
+    if (m_program == program)
+        m_program = UNKNOWN;
+    std::erase_if(m_uniforms, [program](const auto &entry) {
+        return GLuint(entry.first >> 32) == program;
+    });
+    GL(glDeleteProgram(program));
+}
+
+void GLState::delete_vertex_arrays(GLsizei n, const GLuint *vertex_arrays)
+{
+    // deleting what is bound binds 0 in its place
+    for (GLsizei i = 0; i < n; i++) {
+        if (vertex_arrays[i] && m_vertex_array == vertex_arrays[i])
+            m_vertex_array = 0;
+    }
+    GL(glDeleteVertexArrays(n, vertex_arrays));
+}
+
+void GLState::delete_buffers(GLsizei n, const GLuint *buffers)
+{
+    for (GLsizei i = 0; i < n; i++) {
+        if (!buffers[i])
+            continue;
+        for (GLuint *binding : { &m_array_buffer, &m_pack_buffer, &m_unpack_buffer, &m_uniform_buffer }) {
+            if (*binding == buffers[i])
+                *binding = 0;
+        }
+        for (Range &range : m_uniform_ranges) {
+            if (range.buffer == buffers[i])
+                range = { 0, 0, 0 };
+        }
+    }
+    GL(glDeleteBuffers(n, buffers));
+}
+
+void GLState::delete_framebuffers(GLsizei n, const GLuint *framebuffers)
+{
+    for (GLsizei i = 0; i < n; i++) {
+        if (!framebuffers[i])
+            continue;
+        if (m_read_framebuffer == framebuffers[i])
+            m_read_framebuffer = 0;
+        if (m_draw_framebuffer == framebuffers[i])
+            m_draw_framebuffer = 0;
+    }
+    GL(glDeleteFramebuffers(n, framebuffers));
+}
+
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+extern "C" {
+#include <GL/gl.h>
+#include <GL/glext.h>
+};
+
+namespace BlotGL {
+
+// GL calls made through a GLState, and those of them it left out
+struct GLCallCounts {
+    uint64_t issued{};
+    uint64_t skipped{};
+};
+
+// What this thread's GL context has bound and set, so calls that would change
+// nothing never reach the driver (or the GL() error check): the program in use,
+// vertex array, buffers, framebuffers, viewport, clear color, and the uniforms
+// of each program.  It only knows what went through it, so every change to
+// these has to, and deleting objects too, or a name the driver reuses could
+// look bound already.  Untracked buffer targets are passed straight through.
+class GLState final {
+protected:
+    static constexpr GLuint UNKNOWN = GLuint(-1);
+    static constexpr unsigned UNIFORM_BINDINGS = 8;
+
+    struct Range {
+        GLuint buffer{UNKNOWN};
+        GLintptr offset{};
+        GLsizeiptr size{};
+    };
+
+    GLuint m_program{UNKNOWN};
+    GLuint m_vertex_array{UNKNOWN};
+    GLuint m_array_buffer{UNKNOWN};
+    GLuint m_pack_buffer{UNKNOWN};
+    GLuint m_unpack_buffer{UNKNOWN};
+    GLuint m_uniform_buffer{UNKNOWN};
+    std::array<Range, UNIFORM_BINDINGS> m_uniform_ranges{};
+    GLuint m_read_framebuffer{UNKNOWN};
+    GLuint m_draw_framebuffer{UNKNOWN};
+    std::array<GLint, 4> m_viewport{ -1, -1, -1, -1 };
+    std::array<uint32_t, 4> m_clear_color{};
+    bool m_clear_color_known{};
+
+    // uniform values by program and location, as their bits
+    std::unordered_map<uint64_t, std::vector<uint32_t>> m_uniforms;
+
+    GLCallCounts m_counts;
+
+    GLuint* buffer_binding(GLenum target);
+    // whether a call is needed to make current hold value, counted either way
+    bool change(GLuint &current, GLuint value);
+    // the same for a uniform of the program in use
+    bool change_uniform(GLint location, const void *data, size_t bytes);
+
+public:
+    // the one for the context current on this thread
+    static GLState& current();
+
+    // forget everything, when the context is new or something else changed it
+    void reset();
+
+    // counts since the last take_counts(), which starts them over
+    const GLCallCounts& counts() const { return m_counts; }
+    GLCallCounts take_counts();
+
+    void use_program(GLuint program);
+    void bind_vertex_array(GLuint vertex_array);
+    void bind_buffer(GLenum target, GLuint buffer);
+    void bind_buffer_range(GLenum target, GLuint index, GLuint buffer,
+                           GLintptr offset, GLsizeiptr size);
+    // GL_FRAMEBUFFER binds both read and draw
+    void bind_framebuffer(GLenum target, GLuint framebuffer);
+    // what is bound for drawing, only asking the driver if not known
+    GLuint draw_framebuffer();
+    void viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+    void clear_color(GLfloat r, GLfloat g, GLfloat b, GLfloat a);
+
+    // uniforms of the program in use
+    void uniform(GLint location, GLfloat x);
+    void uniform(GLint location, GLfloat x, GLfloat y);
+    void uniform(GLint location, GLfloat x, GLfloat y, GLfloat z);
+    void uniform(GLint location, GLfloat x, GLfloat y, GLfloat z, GLfloat w);
+    void uniform(GLint location, GLint x);
+    void uniform(GLint location, GLint x, GLint y);
+    void uniform3fv(GLint location, GLsizei count, const GLfloat *values);
+
+    // delete objects, and forget them wherever they were bound
+    void delete_program(GLuint program);
+    void delete_vertex_arrays(GLsizei n, const GLuint *vertex_arrays);
+    void delete_buffers(GLsizei n, const GLuint *buffers);
+    void delete_framebuffers(GLsizei n, const GLuint *framebuffers);
+};
+
+}
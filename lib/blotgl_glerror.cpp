@@ -9,7 +9,7 @@ extern "C" {
 
 #include "blotgl_glerror.hpp"
 
-std::vector<std::string> g_blotgl_glerrors;
+thread_local std::vector<std::string> g_blotgl_glerrors;
 
 const char* glErrorToString(GLenum error) {
     switch (error) {
@@ -3,7 +3,8 @@
 #include <string>
 #include "blotgl_utils.hpp"
 
-extern std::vector<std::string> g_blotgl_glerrors;
+// per thread, as each thread has its own GL context
+extern thread_local std::vector<std::string> g_blotgl_glerrors;
 
 extern void blotgl_push_glerror(const char* operation);
 extern size_t blotgl_drain_glerrors();
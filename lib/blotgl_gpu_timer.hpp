@@ -0,0 +1,64 @@
+#pragma once
+#include <array>
+#include <optional>
+
+extern "C" {
+#include <GL/gl.h>
+#include <GL/glext.h>
+};
+
+#include "blotgl_glerror.hpp"
+
+namespace BlotGL {
+
+// GL_TIME_ELAPSED queries kept in a small ring, so results can be collected
+// a few frames later without stalling the pipeline
+class GpuTimer final {
+protected:
+    static constexpr size_t DEPTH = 4;
+    std::array<GLuint, DEPTH> m_queries{};
+    std::array<bool, DEPTH> m_pending{};
+    size_t m_next{};
+
+public:
+    explicit GpuTimer() {
+        GL(glGenQueries(DEPTH, m_queries.data()));
+    }
+    ~GpuTimer() {
+        GL(glDeleteQueries(DEPTH, m_queries.data()));
+    }
+
+    GpuTimer(const GpuTimer&) = delete;
+    GpuTimer& operator=(const GpuTimer&) = delete;
+
+    void begin() {
+        GL(glBeginQuery(GL_TIME_ELAPSED, m_queries[m_next]));
+    }
+    void end() {
+        GL(glEndQuery(GL_TIME_ELAPSED));
+        m_pending[m_next] = true;
+        m_next = (m_next + 1) % DEPTH;
+    }
+
+    // oldest finished measurement in milliseconds, if there is one
+    std::optional<double> poll() {
+        for (size_t i=0; i<DEPTH; i++) {
+            size_t index = (m_next + i) % DEPTH;
+            if (!m_pending[index])
+                continue;
+
+            GLint available = 0;
+            GL(glGetQueryObjectiv(m_queries[index], GL_QUERY_RESULT_AVAILABLE, &available));
+            if (!available)
+                return std::nullopt;
+
+            GLuint64 ns = 0;
+            GL(glGetQueryObjectui64v(m_queries[index], GL_QUERY_RESULT, &ns));
+            m_pending[index] = false;
+            return double(ns) / 1e6;
+        }
+        return std::nullopt;
+    }
+};
+
+}
@@ -0,0 +1,106 @@
+#include "blotgl_kernels.hpp"
+#include "blotgl_frame.hpp"
+
+#include <atomic>
+#include <cstdio>
+
+namespace BlotGL {
+
+// built in blotgl_kernels_<isa>.cpp; BLOTGL_MULTI_ISA is set where the AVX
+// variants are built too
+namespace baseline {
+template <typename FRAME> const FrameKernels<FRAME>& kernels();
+}
+#ifdef BLOTGL_MULTI_ISA
+namespace avx2 {
+template <typename FRAME> const FrameKernels<FRAME>& kernels();
+}
+namespace avx512 {
+template <typename FRAME> const FrameKernels<FRAME>& kernels();
+}
+#endif
+
+static std::atomic<int> g_isa{-1};
+
+const char* isa_name(Isa isa)
+{
+    switch (isa) {
+        case Isa::Avx2:     return "avx2";
+        case Isa::Avx512:   return "avx512";
+        case Isa::Baseline: break;
+    }
+    return "baseline";
+}
+
+std::optional<Isa> parse_isa(std::string_view name)
+{
+    for (auto isa : { Isa::Baseline, Isa::Avx2, Isa::Avx512 }) {
+        if (name == isa_name(isa))
+            return isa;
+    }
+    return std::nullopt;
+}
+
+bool isa_supported(Isa isa)
+{
+    switch (isa) {
+        case Isa::Baseline:
+            return true;
+#ifdef BLOTGL_MULTI_ISA
+        case Isa::Avx2:
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        case Isa::Avx512:
+            return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")
+                && __builtin_cpu_supports("avx512dq") && __builtin_cpu_supports("avx512vl");
+#endif
+        default:
+            return false;
+    }
+}
+
+Isa select_isa(std::optional<Isa> wanted)
+{
+    Isa isa = Isa::Baseline;
+    if (wanted && isa_supported(*wanted)) {
+        isa = *wanted;
+    } else {
+        if (wanted)
+            fprintf(stderr, "%s kernels not available here\n", isa_name(*wanted));
+        for (auto best : { Isa::Avx512, Isa::Avx2 }) {
+            if (isa_supported(best)) {
+                isa = best;
+                break;
+            }
+        }
+    }
+    g_isa = int(isa);
+    return isa;
+}
+
+Isa active_isa()
+{
+    int isa = g_isa;
+    return isa < 0 ? select_isa() : Isa(isa);
+}
+
+template <typename FRAME>
+static const FrameKernels<FRAME>& kernels_for_active_isa()
+{
+    switch (active_isa()) {
+#ifdef BLOTGL_MULTI_ISA
+        case Isa::Avx512:   return avx512::kernels<FRAME>();
+        case Isa::Avx2:     return avx2::kernels<FRAME>();
+#endif
+        default:            return baseline::kernels<FRAME>();
+    }
+}
+
+#define BLOTGL_DEFINE_FRAME_KERNELS(CELL, BPP) \
+    template <> const FrameKernels<Frame<CELL, BPP, true>>& frame_kernels() \
+    { \
+        return kernels_for_active_isa<Frame<CELL, BPP, true>>(); \
+    }
+BLOTGL_FOR_EACH_KERNEL_FRAME(BLOTGL_DEFINE_FRAME_KERNELS)
+#undef BLOTGL_DEFINE_FRAME_KERNELS
+
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "blotgl_cell.hpp"
+#include "blotgl_view.hpp"
+
+namespace BlotGL {
+
+// Instruction sets the hot kernels (pixel to cell conversion, color averaging
+// and encoding) are built for.  The rest of the library is built for the
+// baseline, so binaries run on any x86-64; one set of kernels is picked at
+// startup for the CPU it finds.
+enum class Isa { Baseline, Avx2, Avx512 };
+
+const char* isa_name(Isa isa);
+std::optional<Isa> parse_isa(std::string_view name);
+// built into this binary, and runs on this CPU
+bool isa_supported(Isa isa);
+// use this set of kernels from now on, or the best supported one if not
+// given or not supported; returns the one used
+Isa select_isa(std::optional<Isa> wanted = std::nullopt);
+// the kernels in use, the best supported ones unless select_isa() said otherwise
+Isa active_isa();
+
+template <typename CELL, size_t BPP, bool AVGPXL> class Frame;
+class Encoder;
+class Screen;
+
+// what a Frame runs through the kernels of the active instruction set
+template <typename FRAME>
+struct FrameKernels {
+    void (*convert)(FRAME &frame, bool invert_y_axis, const CellRect &cells);
+    void (*encode)(FRAME &frame, Encoder &enc, Screen *screen,
+                   const std::vector<CellRect> *rects, uint32_t begin, uint32_t end);
+    Isa isa;
+};
+
+// frames that aren't built per instruction set run as compiled where they're used
+template <typename FRAME>
+const FrameKernels<FRAME>& frame_kernels()
+{
+    static constexpr FrameKernels<FRAME> kernels{
+        [](FRAME &frame, bool invert_y_axis, const CellRect &cells) {
+            frame.convert_cells(invert_y_axis, cells);
+        },
+        [](FRAME &frame, Encoder &enc, Screen *screen, const std::vector<CellRect> *rects,
+           uint32_t begin, uint32_t end) {
+            frame.encode_range(enc, screen, rects, begin, end);
+        },
+        Isa::Baseline,
+    };
+    return kernels;
+}
+
+// the ones that are, see blotgl_kernels_isa.hpp
+#define BLOTGL_FOR_EACH_KERNEL_FRAME(X) \
+    X(BrailleCell, 3) X(BrailleCell, 4) \
+    X(Braille2Cell, 3) X(Braille2Cell, 4) \
+    X(HalfBlockCell, 3) X(HalfBlockCell, 4) \
+    X(QuadrantCell, 3) X(QuadrantCell, 4) \
+    X(SextantCell, 3) X(SextantCell, 4)
+
+#define BLOTGL_DECLARE_FRAME_KERNELS(CELL, BPP) \
+    template <> const FrameKernels<Frame<CELL, BPP, true>>& frame_kernels();
+BLOTGL_FOR_EACH_KERNEL_FRAME(BLOTGL_DECLARE_FRAME_KERNELS)
+#undef BLOTGL_DECLARE_FRAME_KERNELS
+
+}
@@ -0,0 +1,4 @@
+// the kernels built for AVX2 and FMA, see blotgl_kernels_isa.hpp
+#define BLOTGL_ISA_NAMESPACE avx2
+#define BLOTGL_ISA Isa::Avx2
+#include "blotgl_kernels_isa.hpp"
@@ -0,0 +1,4 @@
+// the kernels built for AVX-512 (F, BW, DQ, VL), see blotgl_kernels_isa.hpp
+#define BLOTGL_ISA_NAMESPACE avx512
+#define BLOTGL_ISA Isa::Avx512
+#include "blotgl_kernels_isa.hpp"
@@ -0,0 +1,4 @@
+// the kernels built for the baseline instruction set, see blotgl_kernels_isa.hpp
+#define BLOTGL_ISA_NAMESPACE baseline
+#define BLOTGL_ISA Isa::Baseline
+#include "blotgl_kernels_isa.hpp"
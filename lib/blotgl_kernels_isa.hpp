@@ -0,0 +1,42 @@
+// Included once per instruction set by blotgl_kernels_<isa>.cpp, each built
+// with that instruction set's compiler flags, after defining
+// BLOTGL_ISA_NAMESPACE and BLOTGL_ISA.  No #pragma once on purpose.
+#ifndef BLOTGL_ISA_NAMESPACE
+#error "define BLOTGL_ISA_NAMESPACE and BLOTGL_ISA before including blotgl_kernels_isa.hpp"
+#endif
+
+#include "blotgl_frame.hpp"
+#include "blotgl_kernels.hpp"
+
+namespace BlotGL::BLOTGL_ISA_NAMESPACE {
+
+// Flattened, so everything they call is inlined into them and built with
+// this file's flags.  Anything left out of line would be an inline function
+// the linker merges with the baseline build's copy, and could hand to code
+// that runs on CPUs without these instructions.
+template <typename FRAME>
+[[gnu::flatten]] static void convert(FRAME &frame, bool invert_y_axis, const CellRect &cells)
+{
+    frame.convert_cells(invert_y_axis, cells);
+}
+
+template <typename FRAME>
+[[gnu::flatten]] static void encode(FRAME &frame, Encoder &enc, Screen *screen,
+                                    const std::vector<CellRect> *rects, uint32_t begin, uint32_t end)
+{
+    frame.encode_range(enc, screen, rects, begin, end);
+}
+
+template <typename FRAME>
+const FrameKernels<FRAME>& kernels()
+{
+    static constexpr FrameKernels<FRAME> table{ &convert<FRAME>, &encode<FRAME>, BLOTGL_ISA };
+    return table;
+}
+
+#define BLOTGL_INSTANTIATE_KERNELS(CELL, BPP) \
+    template const FrameKernels<Frame<CELL, BPP, true>>& kernels();
+BLOTGL_FOR_EACH_KERNEL_FRAME(BLOTGL_INSTANTIATE_KERNELS)
+#undef BLOTGL_INSTANTIATE_KERNELS
+
+}
@@ -0,0 +1,269 @@
+#define GL_GLEXT_PROTOTYPES
+#include "blotgl_media_layer.hpp"
+#include "blotgl_glerror.hpp"
+#include "blotgl_gl_state.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fmt/core.h>
+
+namespace BlotGL {
+
+// a triangle covering the viewport
+static constexpr const char *vertex_source = R"glsl(
+#version 460 core
+layout(location = 0) out vec2 v_TexCoord;
+void main()
+{
+    vec2 pos = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    v_TexCoord = pos;
+    gl_Position = vec4(pos * 2.0 - 1.0, 0.0, 1.0);
+}
+)glsl";
+
+// the frame fit into the view, black around it; rows come top first
+static constexpr const char *fragment_source = R"glsl(
+#version 460 core
+layout(binding = 0) uniform sampler2D u_frame;
+layout(location = 0) uniform vec2 u_scale;
+layout(location = 0) in vec2 v_TexCoord;
+layout(location = 0) out vec4 o_color;
+void main()
+{
+    vec2 uv = (v_TexCoord - 0.5) / u_scale + 0.5;
+    if (any(lessThan(uv, vec2(0.0))) || any(greaterThan(uv, vec2(1.0)))) {
+        o_color = vec4(0.0, 0.0, 0.0, 1.0);
+        return;
+    }
+    o_color = vec4(texture(u_frame, vec2(uv.x, 1.0 - uv.y)).rgb, 1.0);
+}
+)glsl";
+
+MediaLayer::MediaLayer(const MediaSource &source)
+: Layer(),
+  m_source(source),
+  m_file(source.path),
+  m_frame_bytes(size_t(source.width) * source.height * 3)
+{
+    if (!m_frame_bytes || m_file.size() < m_frame_bytes) {
+        fprintf(stderr, "%s: not %ux%u RGB24 frames\n", source.path.c_str(), source.width, source.height);
+        throw std::runtime_error("MediaLayer: file too small for one frame");
+    }
+    m_frame_count = int64_t(m_file.size() / m_frame_bytes);
+    m_source.fps = m_source.fps > 0 ? m_source.fps : 30;
+
+    // played front to back: read ahead aggressively, and drop pages once behind
+    m_file.advise(MADV_SEQUENTIAL);
+
+    // only frames that show a new picture are redrawn
+    track_damage();
+
+    m_shader = std::make_unique<Shader>(vertex_source, fragment_source);
+    GL(glCreateVertexArrays(1, &m_vertex_array));
+
+    GL(glCreateTextures(GL_TEXTURE_2D, 1, &m_texture));
+    GL(glTextureStorage2D(m_texture, 1, GL_RGB8, source.width, source.height));
+    GL(glTextureParameteri(m_texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+    GL(glTextureParameteri(m_texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+    GL(glTextureParameteri(m_texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+    GL(glTextureParameteri(m_texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+
+    // written by the loader thread while the GPU reads other slots
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    GL(glCreateBuffers(1, &m_buffer));
+    GL(glNamedBufferStorage(m_buffer, SLOTS * m_frame_bytes, nullptr, flags));
+    m_mapped = static_cast<uint8_t*>(glMapNamedBufferRange(m_buffer, 0, SLOTS * m_frame_bytes, flags));
+    if (!m_mapped) {
+        fprintf(stderr, "glMapNamedBufferRange failed\n");
+        GL(glDeleteBuffers(1, &m_buffer));
+        GL(glDeleteTextures(1, &m_texture));
+        GL(glDeleteVertexArrays(1, &m_vertex_array));
+        throw std::runtime_error("MediaLayer: failed to map pixel buffer");
+    }
+}
+
+MediaLayer::~MediaLayer()
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    if (m_loader.joinable())
+        m_loader.join();
+
+    for (auto &slot : m_slots) {
+        if (slot.fence)
+            glDeleteSync(slot.fence);
+    }
+    GL(glUnmapNamedBuffer(m_buffer));
+    GLState::current().delete_buffers(1, &m_buffer);
+    GL(glDeleteTextures(1, &m_texture));
+    GLState::current().delete_vertex_arrays(1, &m_vertex_array);
+}
+
+int64_t MediaLayer::frame_at(float timestamp) const
+{
+    int64_t frame = int64_t(double(timestamp) * m_source.fps);
+    return m_source.loop ? frame : std::min(frame, m_frame_count - 1);
+}
+
+// loader thread: fill free slots with the frames that come next
+void MediaLayer::load_frames()
+{
+    for (;;) {
+        size_t index{};
+        int64_t frame{};
+        {
+            std::unique_lock lock(m_mutex);
+            auto free_slot = [this] {
+                return std::find_if(m_slots.begin(), m_slots.end(),
+                                    [](const Slot &s) { return s.state == SlotState::Free; });
+            };
+            m_cv.wait(lock, [&] {
+                return m_stop || (free_slot() != m_slots.end()
+                                  && (m_source.loop || m_next_load < m_frame_count));
+            });
+            if (m_stop)
+                return;
+            auto slot = free_slot();
+            index = slot - m_slots.begin();
+            frame = m_next_load ++;
+            slot->state = SlotState::Filling;
+            slot->frame = frame;
+        }
+
+        size_t offset = size_t(frame % m_frame_count) * m_frame_bytes;
+        m_file.advise(MADV_WILLNEED, offset + m_frame_bytes, READ_AHEAD * m_frame_bytes);
+        std::memcpy(m_mapped + index * m_frame_bytes, m_file.data<uint8_t>() + offset, m_frame_bytes);
+        // the page cache may keep it, but this process no longer needs it mapped
+        m_file.advise(MADV_DONTNEED, offset, m_frame_bytes);
+
+        {
+            std::lock_guard lock(m_mutex);
+            m_slots[index].state = SlotState::Ready;
+        }
+    }
+}
+
+// slots whose upload the GPU has finished can be filled again
+void MediaLayer::recycle_slots()
+{
+    bool freed = false;
+    for (auto &slot : m_slots) {
+        if (!slot.fence)
+            continue;
+        GLenum status = glClientWaitSync(slot.fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            continue;
+        glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+        std::lock_guard lock(m_mutex);
+        slot.state = SlotState::Free;
+        freed = true;
+    }
+    if (freed)
+        m_cv.notify_one();
+}
+
+// exporting: exactly the frame the timestamp says, straight from the mapping
+void MediaLayer::upload_due(float timestamp)
+{
+    int64_t frame = frame_at(timestamp);
+    if (frame == m_shown)
+        return;
+    size_t offset = size_t(frame % m_frame_count) * m_frame_bytes;
+    GL(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+    GL(glTextureSubImage2D(m_texture, 0, 0, 0, m_source.width, m_source.height,
+                           GL_RGB, GL_UNSIGNED_BYTE, m_file.data<uint8_t>() + offset));
+    GL(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+    m_shown = frame;
+    m_uploaded = true;
+}
+
+void MediaLayer::on_update(const App &app, float timestamp)
+{
+    Viewport viewport = app.get_viewport();
+    m_viewport = viewport;
+    m_pixel_aspect = app.get_pixel_aspect();
+    m_uploaded = false;
+
+    if (!app.config().export_path.empty()) {
+        upload_due(timestamp);
+        if (m_uploaded)
+            damage({ 0, 0, viewport.width, viewport.height });
+        return;
+    }
+
+    // live playback only, an export has no frames to drop
+    if (!m_loader.joinable())
+        m_loader = std::thread(&MediaLayer::load_frames, this);
+
+    recycle_slots();
+
+    // the newest ready frame that is due; older ones were missed and go back
+    int64_t due = frame_at(timestamp);
+    size_t best = SLOTS;
+    {
+        std::lock_guard lock(m_mutex);
+        if (m_next_load < due)
+            m_next_load = due;      // the loader fell behind, skip ahead
+        for (size_t i = 0; i < SLOTS; i++) {
+            const Slot &slot = m_slots[i];
+            if (slot.state == SlotState::Ready && slot.frame <= due && slot.frame > m_shown
+                    && (best == SLOTS || slot.frame > m_slots[best].frame))
+                best = i;
+        }
+        for (auto &slot : m_slots) {
+            if (slot.state == SlotState::Ready && slot.frame < due
+                    && (best == SLOTS || slot.frame < m_slots[best].frame))
+                slot.state = SlotState::Free;
+        }
+        if (best != SLOTS)
+            m_slots[best].state = SlotState::Uploading;
+    }
+    m_cv.notify_one();
+
+    if (best != SLOTS) {
+        Slot &slot = m_slots[best];
+        GLState &gl = GLState::current();
+        gl.bind_buffer(GL_PIXEL_UNPACK_BUFFER, m_buffer);
+        GL(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+        GL(glTextureSubImage2D(m_texture, 0, 0, 0, m_source.width, m_source.height,
+                               GL_RGB, GL_UNSIGNED_BYTE, (const void*)(best * m_frame_bytes)));
+        GL(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+        // other uploads take pointers to memory, not offsets into this
+        gl.bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        m_shown = slot.frame;
+        m_uploaded = true;
+    }
+
+    if (m_uploaded)
+        damage({ 0, 0, viewport.width, viewport.height });
+}
+
+void MediaLayer::on_render()
+{
+    if (m_shown < 0 || !m_viewport.width || !m_viewport.height)
+        return;
+
+    // fit the frame's aspect into the view's, as the terminal shows it
+    float frame_aspect = float(m_source.width) / m_source.height;
+    float view_aspect = m_viewport.width * m_pixel_aspect / m_viewport.height;
+    float sx = 1.0f, sy = 1.0f;
+    if (frame_aspect > view_aspect)
+        sy = view_aspect / frame_aspect;
+    else
+        sx = frame_aspect / view_aspect;
+
+    GLState &gl = GLState::current();
+    m_shader->use();
+    gl.uniform(0, sx, sy);
+    GL(glBindTextureUnit(0, m_texture));
+    gl.bind_vertex_array(m_vertex_array);
+    GL(glDrawArrays(GL_TRIANGLES, 0, 3));
+    GL(glBindTextureUnit(0, 0));
+}
+
+}
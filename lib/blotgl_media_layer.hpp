@@ -0,0 +1,96 @@
+#pragma once
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+extern "C" {
+#include <GL/gl.h>
+#include <GL/glext.h>
+};
+
+#include "blotgl_app.hpp"
+#include "blotgl_mmapped_file.hpp"
+#include "blotgl_shader.hpp"
+
+namespace BlotGL {
+
+// a file of raw frames back to back, top row first, like
+// `ffmpeg -i in.mp4 -f rawvideo -pix_fmt rgb24 out.rgb`
+struct MediaSource {
+    std::string path;
+    unsigned width{};
+    unsigned height{};
+    double fps{30};
+    bool loop{true};
+};
+
+// A layer that plays a raw RGB24 frame sequence, fit into its view.  The file
+// is mapped, never read into memory: the kernel reads ahead of playback and
+// pages that were played are dropped from the mapping again, so files much
+// larger than RAM play back.  A loader thread copies frames from the mapping
+// into a ring of persistently mapped pixel-unpack buffers, and the render
+// thread only ever issues glTexSubImage2D from one that is ready, so neither
+// page faults nor uploads stall the render loop; when the loader falls behind
+// frames are dropped.  Only frames that show a new picture report damage.
+// An export has no loader: each frame uploads the one its timestamp says,
+// waiting for it as long as that takes.
+class MediaLayer : public Layer {
+protected:
+    static constexpr size_t SLOTS = 3;      // frames being filled, ready, or uploading
+    static constexpr size_t READ_AHEAD = 4; // frames the kernel is asked to fetch early
+
+    enum class SlotState { Free, Filling, Ready, Uploading };
+
+    struct Slot {
+        SlotState state{SlotState::Free};
+        int64_t frame{-1};      // sequence number, counts on across loops
+        GLsync fence{};         // while uploading
+    };
+
+    MediaSource m_source;
+    MmappedFile m_file;
+    size_t m_frame_bytes{};
+    int64_t m_frame_count{};
+
+    std::unique_ptr<Shader> m_shader;
+    GLuint m_vertex_array{};
+    GLuint m_texture{};
+    GLuint m_buffer{};          // SLOTS frames, persistently mapped
+    uint8_t *m_mapped{};
+
+    // shared with the loader thread
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::array<Slot, SLOTS> m_slots{};
+    int64_t m_next_load{0};     // next frame the loader fills a slot with
+    bool m_stop{false};
+    std::thread m_loader;
+
+    Viewport m_viewport;
+    float m_pixel_aspect{1.0f};
+    int64_t m_shown{-1};        // frame in the texture
+    bool m_uploaded{false};     // a new one went up this frame
+
+    void load_frames();
+    void recycle_slots();
+    void upload_due(float timestamp);
+    int64_t frame_at(float timestamp) const;
+
+public:
+    explicit MediaLayer(const MediaSource &source);
+    ~MediaLayer() override;
+
+    MediaLayer(const MediaLayer&) = delete;
+    MediaLayer& operator=(const MediaLayer&) = delete;
+
+    int64_t frame_count() const { return m_frame_count; }
+
+    void on_update(const App &app, float timestamp) override;
+    void on_render() override;
+};
+
+}
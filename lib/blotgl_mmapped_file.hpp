@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include <string>
 #include <sys/stat.h>
 #include <sys/mman.h>
@@ -54,6 +55,17 @@ public:
 
     template<typename T = void>
     const T* data() const { return (const T*)m_data; }
+
+    // tell the kernel how part of the mapping will be used (MADV_SEQUENTIAL,
+    // MADV_WILLNEED, MADV_DONTNEED, ...); widened to whole pages, clipped to the file
+    void advise(int advice, size_t offset = 0, size_t length = SIZE_MAX) const {
+        if (!m_data || offset >= m_length)
+            return;
+        length = std::min(length, m_length - offset);
+        size_t page = size_t(sysconf(_SC_PAGESIZE));
+        size_t start = offset / page * page;
+        madvise((uint8_t*)m_data + start, offset + length - start, advice);
+    }
     size_t size() const { return m_length; }
     std::string str() const { return std::string(data<char>(), data<char>() + size()); }
 
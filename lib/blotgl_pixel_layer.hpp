@@ -0,0 +1,52 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "blotgl_app.hpp"
+
+namespace BlotGL {
+
+// A layer's view in the output's RGB pixels, rows counted from the top.  Rows
+// are contiguous runs of width * 3 bytes, whatever order they sit in.
+struct PixelView {
+    uint8_t *top{};             // first pixel of the top row
+    ptrdiff_t stride{};         // bytes from one row to the one below it
+    unsigned width{};
+    unsigned height{};
+
+    uint8_t* row(unsigned y) const { return top + ptrdiff_t(y) * stride; }
+
+    // fn(x, y, rgb) for every pixel of rows begin..end, inlined into the
+    // caller's loop so it can be vectorized
+    template <typename FN>
+    void for_each_pixel(unsigned begin, unsigned end, FN &&fn) const {
+        for (unsigned y = begin; y < end; y++) {
+            uint8_t *rgb = row(y);
+            for (unsigned x = 0; x < width; x++, rgb += 3)
+                fn(x, y, rgb);
+        }
+    }
+};
+
+// A layer computed on the CPU and written straight into the output's pixels,
+// for things simpler or faster there than through GL: cellular automata,
+// particle fields, heat maps.  on_update() runs first, on the render thread,
+// with get_viewport() in output pixels; then render_rows() is called on the
+// App's worker pool, each call with its own run of the view's rows.
+//
+// Pixel layers are drawn over what the GL layers rendered, after it is read
+// back, in the order they were pushed.  An App with BLOTGL_GL=0 has no GL
+// context and runs pixel layers only, on machines without a GPU as well.
+class PixelLayer : public Layer {
+public:
+    explicit PixelLayer() = default;
+
+    // write every pixel of rows begin..end of the view; calls run at the same
+    // time on different rows, and must not touch rows they weren't given
+    virtual void render_rows(const PixelView &view, unsigned begin, unsigned end) = 0;
+
+    // nothing to draw with GL
+    void on_render() final {}
+};
+
+}
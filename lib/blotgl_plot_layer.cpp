@@ -0,0 +1,208 @@
+#define GL_GLEXT_PROTOTYPES
+#include "blotgl_plot_layer.hpp"
+#include "blotgl_glerror.hpp"
+#include "blotgl_gl_state.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <fmt/core.h>
+
+namespace BlotGL {
+
+// columns across the view, values across the range; each draw is one series
+static constexpr const char *vertex_source = R"glsl(
+#version 460 core
+layout(location = 0) in vec2 a_point;
+layout(location = 0) uniform vec2 u_range;
+layout(location = 1) uniform float u_columns;
+layout(location = 2) uniform vec3 u_colors[8];
+layout(location = 0) flat out vec3 v_color;
+void main()
+{
+    float x = (a_point.x + 0.5) / u_columns;
+    float y = (a_point.y - u_range.x) / (u_range.y - u_range.x);
+    v_color = u_colors[gl_DrawID];
+    gl_Position = vec4(vec2(x, y) * 2.0 - 1.0, 0.0, 1.0);
+}
+)glsl";
+
+static constexpr const char *fragment_source = R"glsl(
+#version 460 core
+layout(location = 0) flat in vec3 v_color;
+layout(location = 0) out vec4 o_color;
+void main()
+{
+    o_color = vec4(v_color, 1.0);
+}
+)glsl";
+
+PlotLayer::PlotLayer(const PlotOptions &options)
+: Layer(),
+  m_options(options)
+{
+    if (m_options.series.empty() || m_options.series.size() > MAX_SERIES) {
+        fprintf(stderr, "PlotLayer: %zu series, 1 to %zu are drawn\n",
+                m_options.series.size(), MAX_SERIES);
+        throw std::runtime_error("PlotLayer: bad number of series");
+    }
+    for (auto &series : m_options.series) {
+        if (!series.samples)
+            throw std::runtime_error("PlotLayer: series without samples");
+        m_decimators.emplace_back(m_options.window, m_options.buckets);
+    }
+
+    // only frames with new samples are redrawn
+    track_damage();
+
+    m_shader = std::make_unique<Shader>(vertex_source, fragment_source);
+    GL(glCreateVertexArrays(1, &m_vertex_array));
+    GL(glEnableVertexArrayAttrib(m_vertex_array, 0));
+    GL(glVertexArrayAttribFormat(m_vertex_array, 0, 2, GL_FLOAT, GL_FALSE, 0));
+    GL(glVertexArrayAttribBinding(m_vertex_array, 0, 0));
+}
+
+PlotLayer::~PlotLayer()
+{
+    release();
+    GLState::current().delete_vertex_arrays(1, &m_vertex_array);
+}
+
+void PlotLayer::release()
+{
+    for (auto &fence : m_fences) {
+        if (fence)
+            glDeleteSync(fence);
+        fence = nullptr;
+    }
+    if (!m_buffer)
+        return;
+    GL(glUnmapNamedBuffer(m_buffer));
+    GLState::current().delete_buffers(1, &m_buffer);
+    m_buffer = 0;
+    m_mapped = nullptr;
+    m_region_vertices = 0;
+}
+
+// room for every series at this many columns, in each region
+void PlotLayer::allocate(size_t columns)
+{
+    release();
+
+    m_region_vertices = columns * VERTICES_PER_COLUMN * m_options.series.size();
+    const size_t bytes = REGIONS * m_region_vertices * sizeof(Vertex);
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    GL(glCreateBuffers(1, &m_buffer));
+    GL(glNamedBufferStorage(m_buffer, bytes, nullptr, flags));
+    m_mapped = static_cast<Vertex*>(glMapNamedBufferRange(m_buffer, 0, bytes, flags));
+    if (!m_mapped) {
+        fprintf(stderr, "glMapNamedBufferRange failed\n");
+        GL(glDeleteBuffers(1, &m_buffer));
+        m_buffer = 0;
+        m_region_vertices = 0;
+        throw std::runtime_error("PlotLayer: failed to map vertex buffer");
+    }
+    GL(glVertexArrayVertexBuffer(m_vertex_array, 0, m_buffer, 0, sizeof(Vertex)));
+    m_region = 0;
+}
+
+void PlotLayer::on_update(const App &app, float timestamp)
+{
+    Viewport viewport = app.get_viewport();
+
+    size_t drained = 0;
+    for (size_t i = 0; i < m_decimators.size(); i++) {
+        drained += m_options.series[i].samples->read([&](const float *samples, size_t count) {
+            m_decimators[i].add(samples, count);
+        });
+    }
+    if (!drained && !m_deferred && m_drawn && viewport.width == m_viewport.width
+            && viewport.height == m_viewport.height)
+        return;
+    if (!viewport.width || !viewport.height)
+        return;
+
+    const size_t needed = size_t(viewport.width) * VERTICES_PER_COLUMN * m_options.series.size();
+    if (needed > m_region_vertices)
+        allocate(viewport.width);
+
+    // the GPU may still be drawing from the next region, a few frames back;
+    // keep showing the current one and try again next frame
+    const size_t next = (m_region + 1) % REGIONS;
+    if (GLsync &fence = m_fences[next]) {
+        if (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED) {
+            m_deferred = true;
+            return;
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+    m_region = next;
+    m_deferred = false;
+
+    const size_t base = m_region * m_region_vertices;
+    Vertex *out = m_mapped + base;
+    size_t n = 0;
+    float low = std::numeric_limits<float>::max();
+    float high = std::numeric_limits<float>::lowest();
+    for (size_t i = 0; i < m_decimators.size(); i++) {
+        m_firsts[i] = GLint(base + n);
+        m_decimators[i].columns(viewport.width, [&](size_t column, const M4 &m4) {
+            float x = float(column);
+            out[n++] = { x, m4.first };
+            out[n++] = { x, m4.min };
+            out[n++] = { x, m4.max };
+            out[n++] = { x, m4.last };
+            low = std::min(low, m4.min);
+            high = std::max(high, m4.max);
+        });
+        m_counts[i] = GLsizei(base + n - m_firsts[i]);
+    }
+
+    if (m_options.y_min < m_options.y_max) {
+        low = m_options.y_min;
+        high = m_options.y_max;
+    } else if (!(low < high)) {
+        // flat, or nothing yet
+        float mid = low <= high ? low : 0.0f;
+        low = mid - 1.0f;
+        high = mid + 1.0f;
+    }
+    // half a pixel around it, so the extremes don't fall off the edges
+    float pad = (high - low) / std::max(viewport.height - 1, 1u) * 0.5f;
+    m_low = low - pad;
+    m_high = high + pad;
+    m_viewport = viewport;
+    m_drawn = true;
+
+    damage({ 0, 0, viewport.width, viewport.height });
+}
+
+void PlotLayer::on_render()
+{
+    if (!m_drawn)
+        return;
+
+    std::array<float, MAX_SERIES * 3> colors{};
+    for (size_t i = 0; i < m_options.series.size(); i++) {
+        colors[i * 3 + 0] = m_options.series[i].r;
+        colors[i * 3 + 1] = m_options.series[i].g;
+        colors[i * 3 + 2] = m_options.series[i].b;
+    }
+
+    GLState &gl = GLState::current();
+    m_shader->use();
+    gl.uniform(0, m_low, m_high);
+    gl.uniform(1, float(m_viewport.width));
+    gl.uniform3fv(2, GLsizei(MAX_SERIES), colors.data());
+    gl.bind_vertex_array(m_vertex_array);
+    GL(glMultiDrawArrays(GL_LINE_STRIP, m_firsts.data(), m_counts.data(),
+                         GLsizei(m_options.series.size())));
+
+    // a layer may be rendered more than once a frame, the last draw counts
+    GLsync &fence = m_fences[m_region];
+    if (fence)
+        glDeleteSync(fence);
+    fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <array>
+#include <memory>
+#include <vector>
+
+extern "C" {
+#include <GL/gl.h>
+#include <GL/glext.h>
+};
+
+#include "blotgl_app.hpp"
+#include "blotgl_decimator.hpp"
+#include "blotgl_sample_ring.hpp"
+#include "blotgl_shader.hpp"
+
+namespace BlotGL {
+
+struct PlotSeries {
+    std::shared_ptr<SampleRing> samples;    // fed by another thread
+    float r{1}, g{1}, b{1};
+};
+
+struct PlotOptions {
+    std::vector<PlotSeries> series;
+    size_t window{1 << 20};     // samples across the view, per series
+    size_t buckets{4096};       // the most columns drawn without losing detail
+    float y_min{0};             // value range, fit to what's visible when equal
+    float y_max{0};
+};
+
+// A layer that draws live time series, newest at the right.  Each frame it
+// drains the series' rings into decimators that keep min/max per bucket, then
+// merges those into one M4 run per pixel column: the CPU touches every sample
+// once, and what is uploaded and drawn depends only on the view's width.  The
+// vertices go into a persistently mapped buffer, in one of a few regions in
+// turn so the GPU can still read the last frame's, and all series are drawn
+// with a single glMultiDrawArrays.  Frames without new samples report no
+// damage.  If the GPU still reads the next region, the upload waits a frame
+// instead of stalling on it.
+//
+// The rings have one consumer: push a PlotLayer once.  Export workers would
+// each drain them, so an export with one fails.
+class PlotLayer : public Layer {
+protected:
+    static constexpr size_t MAX_SERIES = 8;
+    static constexpr size_t REGIONS = 3;
+    static constexpr size_t VERTICES_PER_COLUMN = 4;
+
+    struct Vertex {
+        float column;
+        float value;
+    };
+
+    PlotOptions m_options;
+    std::vector<Decimator> m_decimators;
+
+    std::unique_ptr<Shader> m_shader;
+    GLuint m_vertex_array{};
+    GLuint m_buffer{};
+    Vertex *m_mapped{};
+    size_t m_region_vertices{};     // capacity of each region
+    std::array<GLsync, REGIONS> m_fences{};
+    size_t m_region{};
+    bool m_deferred{false};         // samples came in while the next region was busy
+
+    // for on_render()
+    std::array<GLint, MAX_SERIES> m_firsts{};
+    std::array<GLsizei, MAX_SERIES> m_counts{};
+    Viewport m_viewport;
+    float m_low{}, m_high{};
+    bool m_drawn{false};
+
+    void allocate(size_t columns);
+    void release();
+
+public:
+    explicit PlotLayer(const PlotOptions &options);
+    ~PlotLayer() override;
+
+    PlotLayer(const PlotLayer&) = delete;
+    PlotLayer& operator=(const PlotLayer&) = delete;
+
+    void on_update(const App &app, float timestamp) override;
+    void on_render() override;
+    bool exportable() const override { return false; }
+};
+
+}
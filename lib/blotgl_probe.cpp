@@ -0,0 +1,236 @@
+#include "blotgl_probe.hpp"
+#include "blotgl_terminal.hpp"
+
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string_view>
+
+extern "C" {
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <unistd.h>
+};
+
+namespace BlotGL {
+
+static std::string env_or_empty(const char *name)
+{
+    const char *value = std::getenv(name);
+    return value ? value : "";
+}
+
+static std::string cache_path()
+{
+    std::string dir = env_or_empty("XDG_CACHE_HOME");
+    if (dir.empty()) {
+        std::string home = env_or_empty("HOME");
+        if (home.empty())
+            return {};
+        dir = home + "/.cache";
+    }
+    mkdir(dir.c_str(), 0755);
+    dir += "/blotgl";
+    mkdir(dir.c_str(), 0755);
+
+    // one file per terminal, named after it
+    std::string name = "caps-" + env_or_empty("TERM") + "-" + env_or_empty("TERM_PROGRAM");
+    for (char &c : name) {
+        if (!isalnum((unsigned char)c) && c != '-' && c != '.' && c != '_')
+            c = '_';
+    }
+    return dir + "/" + name;
+}
+
+static bool load_cache(const std::string &path, TerminalCaps &caps)
+{
+    std::ifstream in(path);
+    if (!in)
+        return false;
+    std::string line;
+    bool seen = false;
+    while (std::getline(in, line)) {
+        auto eq = line.find('=');
+        if (eq == std::string::npos)
+            continue;
+        std::string_view key(line.data(), eq);
+        std::string value = line.substr(eq + 1);
+        if (key == "truecolor")
+            caps.truecolor = value == "1";
+        else if (key == "sync_output")
+            caps.sync_output = value == "1";
+        else if (key == "lr_margins")
+            caps.lr_margins = value == "1";
+        else if (key == "device_attributes") {
+            caps.device_attributes = value;
+            seen = true;
+        }
+    }
+    caps.probed = seen;
+    return seen;
+}
+
+static void save_cache(const std::string &path, const TerminalCaps &caps)
+{
+    std::ofstream out(path, std::ios::trunc);
+    out << "truecolor=" << caps.truecolor << "\n"
+        << "sync_output=" << caps.sync_output << "\n"
+        << "lr_margins=" << caps.lr_margins << "\n"
+        << "device_attributes=" << caps.device_attributes << "\n";
+}
+
+// walk the escape sequences in the terminal's replies
+template <typename CSI, typename DCS>
+static void scan_replies(std::string_view in, CSI &&on_csi, DCS &&on_dcs)
+{
+    size_t i = 0;
+    while ((i = in.find('\033', i)) != std::string_view::npos && i + 1 < in.size()) {
+        char kind = in[i + 1];
+        size_t start = i + 2;
+        if (kind == '[') {
+            // parameters and intermediates, up to the final byte
+            size_t end = start;
+            while (end < in.size() && !(in[end] >= 0x40 && in[end] <= 0x7E))
+                end ++;
+            if (end == in.size())
+                return;
+            on_csi(in.substr(start, end - start), in[end]);
+            i = end + 1;
+        } else if (kind == 'P') {
+            // device control string, up to ST
+            size_t end = in.find("\033\\", start);
+            if (end == std::string_view::npos)
+                return;
+            on_dcs(in.substr(start, end - start));
+            i = end + 2;
+        } else {
+            i = start;
+        }
+    }
+}
+
+static TerminalCaps query_terminal(int tty, unsigned timeout_ms)
+{
+    TerminalCaps caps;
+
+    // set a truecolor SGR and ask for it back, ask about modes 2026 and 69 and
+    // the text area size, then the device attributes everyone answers
+    static constexpr std::string_view queries =
+        TERM_CSI "38;2;1;2;3m"
+        "\033P$qm\033\\"
+        TERM_COLOR_RESET
+        TERM_CSI "?2026$p"
+        TERM_CSI "?69$p"
+        TERM_CSI "14t"
+        TERM_CSI "c";
+    if (write(tty, queries.data(), queries.size()) != ssize_t(queries.size()))
+        return caps;
+
+    std::string replies;
+    bool have_da1 = false;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+
+    while (!have_da1) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        deadline - std::chrono::steady_clock::now()).count();
+        if (left <= 0)
+            break;
+        struct pollfd pfd{ .fd = tty, .events = POLLIN };
+        if (poll(&pfd, 1, int(left)) <= 0)
+            break;
+        char buf[256];
+        ssize_t n = read(tty, buf, sizeof(buf));
+        if (n <= 0)
+            break;
+        replies.append(buf, n);
+
+        scan_replies(replies,
+            [&](std::string_view params, char final) {
+                if (final == 'c' && params.starts_with('?')) {
+                    caps.device_attributes = std::string(params);
+                    have_da1 = true;
+                } else if (final == 'y' && params.starts_with("?2026;")) {
+                    // 1 set, 2 reset, 3 permanently set are all usable; 0 and 4 are not
+                    char value = params.size() > 6 ? params[6] : '0';
+                    caps.sync_output = value == '1' || value == '2' || value == '3';
+                } else if (final == 'y' && params.starts_with("?69;")) {
+                    char value = params.size() > 4 ? params[4] : '0';
+                    caps.lr_margins = value == '1' || value == '2' || value == '3';
+                } else if (final == 't' && params.starts_with("4;")) {
+                    unsigned h{}, w{};
+                    if (sscanf(params.data(), "4;%u;%u", &h, &w) == 2) {
+                        caps.pixel_width = w;
+                        caps.pixel_height = h;
+                    }
+                }
+            },
+            [&](std::string_view body) {
+                // "1$r" and the SGR it has now; some write 38:2::1:2:3 or 38:2:1:2:3
+                if (body.starts_with("1$r")) {
+                    caps.truecolor = body.find("2;1;2;3") != std::string_view::npos
+                                  || body.find(":1:2:3") != std::string_view::npos;
+                }
+            });
+    }
+
+    caps.probed = have_da1;
+    return caps;
+}
+
+TerminalCaps probe_terminal(unsigned timeout_ms, bool use_cache)
+{
+    TerminalCaps caps;
+
+    if (!isatty(STDOUT_FILENO) || !isatty(STDIN_FILENO))
+        return caps;
+
+    std::string path = cache_path();
+    bool cached = use_cache && !path.empty() && load_cache(path, caps);
+
+    if (!cached) {
+        int tty = open("/dev/tty", O_RDWR | O_NOCTTY | O_CLOEXEC);
+        if (tty < 0)
+            return caps;
+
+        // no echo and no line buffering, or the replies land on screen
+        struct termios saved{}, raw{};
+        if (tcgetattr(tty, &saved) == 0) {
+            raw = saved;
+            raw.c_lflag &= ~(ICANON | ECHO);
+            raw.c_cc[VMIN] = 0;
+            raw.c_cc[VTIME] = 0;
+            tcsetattr(tty, TCSANOW, &raw);
+
+            caps = query_terminal(tty, timeout_ms);
+
+            tcsetattr(tty, TCSANOW, &saved);
+        }
+        close(tty);
+
+        if (caps.probed && !path.empty())
+            save_cache(path, caps);
+    }
+
+    // the answer only holds until the window is resized, so is never cached
+    try {
+        auto ws = linux_terminal_winsize();
+        if (ws.ws_xpixel && ws.ws_ypixel) {
+            caps.pixel_width = ws.ws_xpixel;
+            caps.pixel_height = ws.ws_ypixel;
+        }
+    } catch (const std::exception &ex) {}
+
+    // what the environment claims, for terminals that don't answer DECRQSS
+    std::string colorterm = env_or_empty("COLORTERM");
+    if (colorterm == "truecolor" || colorterm == "24bit")
+        caps.truecolor = true;
+
+    return caps;
+}
+
+}
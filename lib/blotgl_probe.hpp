@@ -0,0 +1,24 @@
+#pragma once
+#include <string>
+
+namespace BlotGL {
+
+// what the terminal on stdout can do, as far as the encoder cares
+struct TerminalCaps {
+    bool probed{false};         // the terminal answered, the rest is not just assumed
+    bool truecolor{true};       // 24-bit SGR colors, otherwise the 256 color palette
+    bool sync_output{false};    // synchronized output, DEC private mode 2026
+    bool lr_margins{false};     // left and right margins, DECLRMM (mode 69) and DECSLRM
+    unsigned pixel_width{};     // text area in pixels, 0 if unknown
+    unsigned pixel_height{};
+    std::string device_attributes;  // primary DA reply parameters, e.g. "?62;22"
+};
+
+// Asks the terminal on stdout: primary device attributes, truecolor (DECRQSS
+// of a 24-bit SGR), modes 2026 and 69 (DECRQM), and text area size in pixels (CSI 14 t).
+// Every terminal answers DA1, so it goes last and marks the end of the replies;
+// the timeout covers ones that don't.  Results, other than the pixel size, are
+// cached under $XDG_CACHE_HOME/blotgl per $TERM and $TERM_PROGRAM.
+TerminalCaps probe_terminal(unsigned timeout_ms, bool use_cache = true);
+
+}
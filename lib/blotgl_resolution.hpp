@@ -0,0 +1,65 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+
+namespace BlotGL {
+
+// Picks an internal render scale that holds the measured GPU frame time near
+// a target.  Fragment cost is proportional to pixel count, so the scale (which
+// applies to both axes) moves by the square root of the time ratio.
+class ResolutionScaler final {
+protected:
+    double m_target_ms{};
+    float m_min_scale{};
+    float m_scale{1.0f};
+    double m_avg_ms{};
+    unsigned m_settle{};
+
+    static constexpr float SCALE_STEP = 1.0f / 16;  // scale is quantized so buffers aren't reallocated every frame
+    static constexpr double SMOOTHING = 0.2;        // weight of the newest sample in the moving average
+    static constexpr double UNDER_BUDGET = 0.80;    // only grow when well under the target
+    static constexpr double OVER_BUDGET = 1.05;     // shrink as soon as we go over the target
+    static constexpr unsigned SETTLE_FRAMES = 8;    // samples to ignore after a change
+
+public:
+    explicit ResolutionScaler(double target_ms = 0, float min_scale = 0.25f)
+    : m_target_ms(target_ms),
+      m_min_scale(std::clamp(min_scale, SCALE_STEP, 1.0f)) { }
+
+    bool enabled() const { return m_target_ms > 0; }
+    float scale() const { return m_scale; }
+    double average_ms() const { return m_avg_ms; }
+
+    // feed the GPU time of one frame, returns true if the scale changed
+    bool update(double gpu_ms) {
+        if (!enabled())
+            return false;
+
+        m_avg_ms = m_avg_ms ? m_avg_ms + SMOOTHING * (gpu_ms - m_avg_ms) : gpu_ms;
+
+        if (m_settle) {
+            m_settle --;
+            return false;
+        }
+
+        bool over = m_avg_ms > m_target_ms * OVER_BUDGET;
+        bool under = m_avg_ms < m_target_ms * UNDER_BUDGET;
+        if (!over && !under)
+            return false;
+
+        float want = m_scale * std::sqrt(m_target_ms / std::max(m_avg_ms, 1e-3));
+        if (under)
+            want = std::min(want, m_scale + 2 * SCALE_STEP); // creep up, drop fast
+        want = std::clamp(std::round(want / SCALE_STEP) * SCALE_STEP, m_min_scale, 1.0f);
+
+        if (want == m_scale)
+            return false;
+
+        m_scale = want;
+        m_avg_ms = 0;
+        m_settle = SETTLE_FRAMES;
+        return true;
+    }
+};
+
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+
+namespace BlotGL {
+
+// A lock-free ring of samples from one producer thread to one consumer.  The
+// producer writes batches and never blocks: what doesn't fit is dropped and
+// counted.  The consumer is handed the samples in place, at most two runs per
+// read, so nothing is copied twice.  The producer keeps its own copy of the
+// consumer's position and only reloads it when the ring looks full.
+class SampleRing final {
+protected:
+    static constexpr size_t LINE = 64;
+
+    std::unique_ptr<float[]> m_samples;
+    size_t m_mask;
+
+    // written by the producer
+    alignas(LINE) std::atomic<size_t> m_head{0};
+    size_t m_tail_cache{0};
+    std::atomic<size_t> m_dropped{0};
+
+    // written by the consumer
+    alignas(LINE) std::atomic<size_t> m_tail{0};
+
+public:
+    // holds at least capacity samples, rounded up to a power of two
+    explicit SampleRing(size_t capacity = 1 << 20) {
+        size_t size = 1;
+        while (size < capacity)
+            size <<= 1;
+        m_samples = std::make_unique<float[]>(size);
+        m_mask = size - 1;
+    }
+
+    SampleRing(const SampleRing&) = delete;
+    SampleRing& operator=(const SampleRing&) = delete;
+
+    size_t capacity() const { return m_mask + 1; }
+    size_t written() const { return m_head.load(std::memory_order_relaxed); }
+    size_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+    // producer: append what fits, returns how many did
+    size_t write(const float *samples, size_t count) {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        size_t space = capacity() - (head - m_tail_cache);
+        if (space < count) {
+            m_tail_cache = m_tail.load(std::memory_order_acquire);
+            space = capacity() - (head - m_tail_cache);
+        }
+        size_t n = std::min(count, space);
+        size_t at = head & m_mask;
+        size_t first = std::min(n, capacity() - at);
+        std::memcpy(&m_samples[at], samples, first * sizeof(float));
+        std::memcpy(&m_samples[0], samples + first, (n - first) * sizeof(float));
+        m_head.store(head + n, std::memory_order_release);
+        if (n < count)
+            m_dropped.fetch_add(count - n, std::memory_order_relaxed);
+        return n;
+    }
+
+    bool write(float sample) { return write(&sample, 1) == 1; }
+
+    // consumer: fn(const float *samples, size_t count) for everything written
+    // so far, oldest first; returns the number of samples consumed
+    template <typename FN>
+    size_t read(FN &&fn) {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        size_t n = m_head.load(std::memory_order_acquire) - tail;
+        if (!n)
+            return 0;
+        size_t at = tail & m_mask;
+        size_t first = std::min(n, capacity() - at);
+        fn(&m_samples[at], first);
+        if (n > first)
+            fn(&m_samples[0], n - first);
+        m_tail.store(tail + n, std::memory_order_release);
+        return n;
+    }
+};
+
+}
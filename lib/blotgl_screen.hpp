@@ -0,0 +1,215 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+#include "blotgl_color.hpp"
+
+namespace BlotGL {
+
+struct ScreenOptions {
+    // cells whose colors moved less than this are left as they are on screen;
+    // roughly in steps of luma (0..255), 0 re-sends every change
+    float distance{0};
+    // a cell left showing an older color is re-sent after this many frames (0 never)
+    unsigned refresh{30};
+    // when a frame is what the terminal shows moved up or down, scroll it into
+    // place rather than resend it; left and right as well with columns, which
+    // needs the terminal to have left and right margins (DECLRMM)
+    bool scroll{false};
+    bool scroll_columns{false};
+};
+
+// how far a frame's content moved from what is shown, in cells: up and left
+// are positive, down and right negative
+struct ScrollShift {
+    int rows{};
+    int columns{};
+
+    explicit operator bool() const { return rows || columns; }
+};
+
+// What the terminal is currently showing, cell by cell, so a frame only has to
+// send the cells that changed.  A cell is compared with what was last sent for
+// it, not with the previous frame, so skipped updates never add up to more
+// than options().distance; refresh bounds how long even that much error stays.
+class Screen final {
+protected:
+    struct Shown {
+        color24 fg;
+        uint8_t glyph;
+        color24 bg;
+        uint8_t age;        // frames it has been left showing an older color
+    };
+
+    ScreenOptions m_options;
+    float m_distance2;
+    std::vector<Shown> m_cells;
+    unsigned m_width{};
+    unsigned m_height{};
+    bool m_valid{};
+
+    // perceptual distance, squared: YCbCr differences with chroma weighted down
+    static float distance2(color24 a, color24 b) {
+        float dr = float(a.r) - float(b.r);
+        float dg = float(a.g) - float(b.g);
+        float db = float(a.b) - float(b.b);
+        float y  =  0.299f  * dr + 0.587f  * dg + 0.114f  * db;
+        float cb = -0.1687f * dr - 0.3313f * dg + 0.5f    * db;
+        float cr =  0.5f    * dr - 0.4187f * dg - 0.0813f * db;
+        return y * y + 0.25f * (cb * cb + cr * cr);
+    }
+
+    bool close_enough(color24 shown, color24 wanted) const {
+        if (shown == wanted)
+            return true;
+        // default is a different thing from a dark color, never merge across it
+        if (!shown || !wanted)
+            return false;
+        return distance2(shown, wanted) < m_distance2;
+    }
+
+    // the shift that lines up the most non-blank hashes of wanted with shown,
+    // wanted[i] == shown[i + shift]; 0 unless it clearly beats not moving
+    static int find_shift(const std::vector<uint64_t> &wanted, const std::vector<uint64_t> &shown,
+                          uint64_t blank) {
+        int n = int(wanted.size());
+        auto matches = [&](int shift) {
+            unsigned count = 0;
+            for (int i = std::max(0, -shift); i < std::min(n, n - shift); i++)
+                count += wanted[i] == shown[i + shift] && wanted[i] != blank;
+            return count;
+        };
+        // past half the screen a scroll saves less than it risks
+        unsigned still = matches(0), best = 0;
+        int best_shift = 0;
+        for (int shift = 1; shift <= n / 2; shift++) {
+            for (int s : { shift, -shift }) {
+                unsigned count = matches(s);
+                if (count > best) {
+                    best = count;
+                    best_shift = s;
+                }
+            }
+        }
+        if (best < still + std::max(2u, unsigned(n) / 8))
+            return 0;
+        return best_shift;
+    }
+
+    uint64_t shown_row_hash(unsigned y) const {
+        uint64_t h = HASH_SEED;
+        for (unsigned x = 0; x < m_width; x++) {
+            const Shown &cell = m_cells[size_t(y) * m_width + x];
+            h = hash(h, cell.glyph, cell.fg, cell.bg);
+        }
+        return h;
+    }
+
+    uint64_t shown_column_hash(unsigned x) const {
+        uint64_t h = HASH_SEED;
+        for (unsigned y = 0; y < m_height; y++) {
+            const Shown &cell = m_cells[size_t(y) * m_width + x];
+            h = hash(h, cell.glyph, cell.fg, cell.bg);
+        }
+        return h;
+    }
+
+public:
+    explicit Screen(const ScreenOptions &options = {})
+    : m_options(options),
+      m_distance2(options.distance * options.distance) {
+        m_options.refresh = std::min(m_options.refresh, 255u);
+    }
+
+    const ScreenOptions& options() const { return m_options; }
+
+    // forget what is on screen, the next frame is sent in full
+    void invalidate() { m_valid = false; }
+
+    // start a frame of width x height cells; true if the terminal has to be
+    // cleared and every cell sent, as nothing is known about what it shows
+    bool begin_frame(unsigned width, unsigned height) {
+        if (m_valid && width == m_width && height == m_height)
+            return false;
+        m_width = width;
+        m_height = height;
+        m_cells.assign(size_t(width) * height, Shown{});
+        m_valid = true;
+        return true;
+    }
+
+    // whether the cell at index needs to be sent to show glyph/fg/bg, and if so
+    // it is recorded as shown; fg and bg that aren't visible should be passed as black
+    bool update(size_t index, uint8_t glyph, color24 fg, color24 bg) {
+        Shown &cell = m_cells[index];
+        if (cell.glyph == glyph && cell.fg == fg && cell.bg == bg) {
+            cell.age = 0;
+            return false;
+        }
+        if (cell.glyph == glyph && close_enough(cell.fg, fg) && close_enough(cell.bg, bg)) {
+            if (!m_options.refresh || ++ cell.age < m_options.refresh)
+                return false;
+        }
+        cell = { .fg = fg, .glyph = glyph, .bg = bg, .age = 0 };
+        return true;
+    }
+
+    // runs of cells are compared by hashes built from a seed with hash(), a cell
+    // at a time, given what update() would be
+    static constexpr uint64_t HASH_SEED = 0xcbf29ce484222325ull;
+    static uint64_t hash(uint64_t h, uint8_t glyph, color24 fg, color24 bg) {
+        uint64_t v = uint64_t(glyph)
+                   | uint64_t(fg.r) << 8 | uint64_t(fg.g) << 16 | uint64_t(fg.b) << 24
+                   | uint64_t(bg.r) << 32 | uint64_t(bg.g) << 40 | uint64_t(bg.b) << 48;
+        h = (h ^ v) * 0x100000001b3ull;
+        return h ^ (h >> 29);
+    }
+
+    // how the frame with these row and column hashes is shifted from what is
+    // shown, if options() allow scrolling and enough of it lines up
+    ScrollShift find_scroll(const std::vector<uint64_t> &rows,
+                            const std::vector<uint64_t> &columns) const {
+        ScrollShift shift;
+        if (!m_options.scroll || !m_valid || rows.size() != m_height || columns.size() != m_width)
+            return shift;
+
+        std::vector<uint64_t> shown(m_height);
+        for (unsigned y = 0; y < m_height; y++)
+            shown[y] = shown_row_hash(y);
+        uint64_t blank = HASH_SEED;
+        for (unsigned x = 0; x < m_width; x++)
+            blank = hash(blank, 0, {}, {});
+        shift.rows = find_shift(rows, shown, blank);
+
+        // a frame moved both ways has no columns in common, so one or the other
+        if (!shift.rows && m_options.scroll_columns) {
+            shown.resize(m_width);
+            for (unsigned x = 0; x < m_width; x++)
+                shown[x] = shown_column_hash(x);
+            blank = HASH_SEED;
+            for (unsigned y = 0; y < m_height; y++)
+                blank = hash(blank, 0, {}, {});
+            shift.columns = find_shift(columns, shown, blank);
+        }
+        return shift;
+    }
+
+    // the terminal was scrolled by shift, what moved off is gone and blanks moved in
+    void scroll(const ScrollShift &shift) {
+        std::vector<Shown> moved(m_cells.size(), Shown{});
+        for (int y = 0; y < int(m_height); y++) {
+            int from_y = y + shift.rows;
+            if (from_y < 0 || from_y >= int(m_height))
+                continue;
+            for (int x = 0; x < int(m_width); x++) {
+                int from_x = x + shift.columns;
+                if (from_x >= 0 && from_x < int(m_width))
+                    moved[size_t(y) * m_width + x] = m_cells[size_t(from_y) * m_width + from_x];
+            }
+        }
+        m_cells.swap(moved);
+    }
+};
+
+}
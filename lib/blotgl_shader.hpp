@@ -1,8 +1,14 @@
 #pragma once
+#include <algorithm>
+#include <bit>
 #include <cassert>
 #include <ostream>
 #include <vector>
 #include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
 #include <fmt/core.h>
 #include <fmt/ostream.h>
 
@@ -17,15 +23,75 @@ extern "C" {
 };
 
 #include "blotgl_glerror.hpp"
+#include "blotgl_gl_state.hpp"
 
 namespace BlotGL {
 
+// a value for a specialization constant, layout(constant_id = id) in GLSL;
+// GL takes the bits of an int, uint, float or bool as they are
+struct SpecConstant {
+    GLuint id;
+    GLuint value;
+
+    static SpecConstant of(GLuint id, int32_t v) { return { id, std::bit_cast<GLuint>(v) }; }
+    static SpecConstant of(GLuint id, uint32_t v) { return { id, v }; }
+    static SpecConstant of(GLuint id, float v) { return { id, std::bit_cast<GLuint>(v) }; }
+    static SpecConstant of(GLuint id, bool v) { return { id, v ? 1u : 0u }; }
+};
+
+// Linked programs, by the sources they were built from, for contexts that share
+// objects with each other (like App's and its export workers'), so each is only
+// compiled and linked once.  Only programs whose state all lives in the context
+// are kept: uniform blocks and samplers, which are bound per context.  Plain
+// uniforms are values of the program itself, which contexts rendering at the
+// same time would overwrite for each other, so those programs stay per Shader.
+class ProgramCache final {
+protected:
+    struct Entry {
+        GLuint program;
+        unsigned users;
+    };
+    std::mutex m_mutex;
+    std::map<std::string, Entry, std::less<>> m_programs;
+
+public:
+    // the program for key, counted as one more user; 0 if there is none
+    GLuint acquire(std::string_view key) {
+        std::lock_guard lock(m_mutex);
+        auto it = m_programs.find(key);
+        if (it == m_programs.end())
+            return 0;
+        it->second.users ++;
+        return it->second.program;
+    }
+    // offer a program for key, with its creator as the first user; false if
+    // another one got there first
+    bool publish(std::string key, GLuint program) {
+        std::lock_guard lock(m_mutex);
+        return m_programs.try_emplace(std::move(key), Entry{ program, 1 }).second;
+    }
+    // one user less; true if that was the last, and the program is to be deleted
+    bool release(std::string_view key) {
+        std::lock_guard lock(m_mutex);
+        auto it = m_programs.find(key);
+        if (it == m_programs.end() || --it->second.users)
+            return false;
+        m_programs.erase(it);
+        return true;
+    }
+};
+
 class Shader final {
 protected:
     GLuint m_fragment_shader{};
     GLuint m_vertex_shader{};
     GLuint m_shader_program{};
     bool m_check_status{true};
+    ProgramCache *m_cache{};    // where m_shader_program came from or went to
+    std::string m_key;
+
+    // the cache of the contexts this thread's belongs to, see share_programs()
+    static inline thread_local ProgramCache *g_programs{};
 
     static void check_shader_status(GLuint part, GLuint stage, const char *desc)
     {
@@ -61,10 +127,114 @@ protected:
         }
     }
 
+    static GLuint load_spirv(GLenum type, const unsigned char *spirv, size_t size,
+                             const std::vector<SpecConstant> &constants, const char *desc)
+    {
+        std::vector<GLuint> ids, values;
+        for (const auto &constant : constants) {
+            ids.push_back(constant.id);
+            values.push_back(constant.value);
+        }
+
+        GLuint shader = glCreateShader(type);
+        GL(glShaderBinary(1, &shader, GL_SHADER_BINARY_FORMAT_SPIR_V, spirv, GLsizei(size)));
+        GL(glSpecializeShader(shader, "main", GLuint(ids.size()), ids.data(), values.data()));
+        try {
+            check_shader_status(shader, GL_COMPILE_STATUS, desc);
+            // a module the driver can't take may fail without a log
+            GLint status = GL_FALSE;
+            glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+            if (status == GL_FALSE)
+                throw std::runtime_error(std::format("{} Error", desc));
+        } catch (...) {
+            glDeleteShader(shader);
+            throw;
+        }
+        return shader;
+    }
+
+    void link() {
+        m_shader_program = glCreateProgram();
+        GL(glAttachShader(m_shader_program, m_vertex_shader));
+        GL(glAttachShader(m_shader_program, m_fragment_shader));
+        GL(glLinkProgram(m_shader_program));
+
+        check_program_status(m_shader_program, GL_LINK_STATUS, "Shader Program Link");
+    }
+
+    // no state of its own other contexts could change under it, see ProgramCache
+    static bool bound_per_context(GLuint program) {
+        GLint count = 0;
+        glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+        for (GLuint i = 0; i < GLuint(count); i++) {
+            GLint block = -1, type = 0;
+            glGetActiveUniformsiv(program, 1, &i, GL_UNIFORM_BLOCK_INDEX, &block);
+            glGetActiveUniformsiv(program, 1, &i, GL_UNIFORM_TYPE, &type);
+            if (block < 0 && !is_sampler(type))
+                return false;
+        }
+        return true;
+    }
+
+    static bool is_sampler(GLint type) {
+        switch (type) {
+            case GL_SAMPLER_1D: case GL_SAMPLER_2D: case GL_SAMPLER_3D: case GL_SAMPLER_CUBE:
+            case GL_SAMPLER_2D_ARRAY: case GL_SAMPLER_2D_RECT: case GL_SAMPLER_BUFFER:
+            case GL_SAMPLER_2D_SHADOW: case GL_SAMPLER_2D_MULTISAMPLE:
+            case GL_INT_SAMPLER_2D: case GL_INT_SAMPLER_3D: case GL_INT_SAMPLER_2D_ARRAY:
+            case GL_UNSIGNED_INT_SAMPLER_2D: case GL_UNSIGNED_INT_SAMPLER_3D:
+            case GL_UNSIGNED_INT_SAMPLER_2D_ARRAY:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    // take the program another Shader built from the same key, if there is one
+    bool adopt(std::string key) {
+        if (!g_programs)
+            return false;
+        m_shader_program = g_programs->acquire(key);
+        if (!m_shader_program)
+            return false;
+        m_cache = g_programs;
+        m_key = std::move(key);
+        return true;
+    }
+
+    // once linked, offer the program to the others
+    void publish(std::string key) {
+        if (!g_programs || !bound_per_context(m_shader_program))
+            return;
+        if (g_programs->publish(key, m_shader_program)) {
+            m_cache = g_programs;
+            m_key = std::move(key);
+        }
+    }
 
 public:
+    // GL_ARB_gl_spirv, core since 4.6: the driver takes SPIR-V modules
+    static bool spirv_supported() {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_SHADER_BINARY_FORMATS, &count);
+        if (count <= 0)
+            return false;
+        std::vector<GLint> formats(count);
+        glGetIntegerv(GL_SHADER_BINARY_FORMATS, formats.data());
+        return std::ranges::find(formats, GLint(GL_SHADER_BINARY_FORMAT_SPIR_V)) != formats.end();
+    }
+
+    // from now on, Shaders made on this thread take their programs from and
+    // offer them to cache, which all contexts made current here share objects
+    // with; nullptr stops that
+    static void share_programs(ProgramCache *cache) { g_programs = cache; }
+
     explicit Shader(const char *vertex_shader_source,
                     const char *fragment_shader_source) {
+        std::string key = std::string("glsl") + '\0' + vertex_shader_source + '\0' + fragment_shader_source;
+        if (adopt(key))
+            return;
+
         m_vertex_shader = glCreateShader(GL_VERTEX_SHADER);
         GL(glShaderSource(m_vertex_shader, 1, &vertex_shader_source, NULL));
         GL(glCompileShader(m_vertex_shader));
@@ -77,16 +247,47 @@ public:
 
         check_shader_status(m_fragment_shader, GL_COMPILE_STATUS, "Fragment Shader Compile");
 
-        m_shader_program = glCreateProgram();
-        GL(glAttachShader(m_shader_program, m_vertex_shader));
-        GL(glAttachShader(m_shader_program, m_fragment_shader));
-        GL(glLinkProgram(m_shader_program));
+        link();
+        publish(std::move(key));
+    }
 
-        check_program_status(m_shader_program, GL_LINK_STATUS, "Shader Program Link");
+    // from SPIR-V modules with their entry points called main; the constants
+    // specialize the fragment shader, check spirv_supported() first
+    explicit Shader(const unsigned char *vertex_spirv, size_t vertex_size,
+                    const unsigned char *fragment_spirv, size_t fragment_size,
+                    const std::vector<SpecConstant> &fragment_constants = {}) {
+        std::string key("spirv");
+        key.append(reinterpret_cast<const char*>(&vertex_size), sizeof(vertex_size));
+        key.append(reinterpret_cast<const char*>(vertex_spirv), vertex_size);
+        key.append(reinterpret_cast<const char*>(fragment_spirv), fragment_size);
+        for (const auto &constant : fragment_constants)
+            key.append(reinterpret_cast<const char*>(&constant), sizeof(constant));
+        if (adopt(key))
+            return;
+
+        m_vertex_shader = load_spirv(GL_VERTEX_SHADER, vertex_spirv, vertex_size,
+                                     {}, "Vertex Shader Specialize");
+        try {
+            m_fragment_shader = load_spirv(GL_FRAGMENT_SHADER, fragment_spirv, fragment_size,
+                                           fragment_constants, "Fragment Shader Specialize");
+            link();
+            publish(std::move(key));
+        } catch (...) {
+            glDeleteProgram(m_shader_program);
+            glDeleteShader(m_vertex_shader);
+            glDeleteShader(m_fragment_shader);
+            throw;
+        }
     }
 
+    Shader(const Shader&) = delete;
+    Shader& operator=(const Shader&) = delete;
+
     ~Shader() {
-        GL(glDeleteProgram(m_shader_program));
+        // a shared program goes with its last user, whichever context that is in
+        if (!m_cache || m_cache->release(m_key))
+            GLState::current().delete_program(m_shader_program);
+        // none of their own when the program was adopted, deleting 0 does nothing
         GL(glDeleteShader(m_vertex_shader));
         GL(glDeleteShader(m_fragment_shader));
     }
@@ -96,7 +297,7 @@ public:
             check_program_status(m_shader_program, GL_VALIDATE_STATUS, "Shader Program Validation");
             m_check_status = false;
         }
-        GL(glUseProgram(m_shader_program));
+        GLState::current().use_program(m_shader_program);
     }
 
 };
@@ -0,0 +1,371 @@
+#define GL_GLEXT_PROTOTYPES
+#include "blotgl_shader_layer.hpp"
+#include "blotgl_mmapped_file.hpp"
+#include "blotgl_glerror.hpp"
+#include "blotgl_utils.hpp"
+
+#include "shadertoy_vertex.glsl.hpp"
+#include "shadertoy_prologue.glsl.hpp"
+#include "shadertoy_epilogue.glsl.hpp"
+#include "checkerboard_stencil.glsl.hpp"
+#include "checkerboard_resolve.glsl.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <format>
+#include <regex>
+
+namespace BlotGL {
+
+std::string ShaderLayer::build_source(const std::string &common, const ShaderPass &spec)
+{
+    std::string source = shaders::shadertoy_prologue.source;
+    if (!common.empty()) {
+        source += "#line 1\n";
+        source += MmappedFile(common).str();
+        source += '\n';
+    }
+    // so compile errors point at lines of the file
+    source += "#line 1\n";
+    source += spec.embedded ? std::string(spec.embedded->source) : MmappedFile(spec.path).str();
+    source += '\n';
+    source += shaders::shadertoy_epilogue.source;
+    specialize_source(source, spec.constants);
+    return source;
+}
+
+// GLSL only has specialization constants when it is compiled to SPIR-V, so
+// compiled as it is, each one becomes a plain constant with its value
+void ShaderLayer::specialize_source(std::string &source, const std::vector<SpecConstant> &constants)
+{
+    static const std::regex declaration(
+        R"(layout\s*\(\s*constant_id\s*=\s*(\d+)\s*\)\s*const\s+(\w+)\s+(\w+)\s*=\s*([^;]*);)");
+
+    std::string out;
+    auto last = source.cbegin();
+    for (std::sregex_iterator it(source.cbegin(), source.cend(), declaration), end; it != end; ++it) {
+        const auto &match = *it;
+        const GLuint id = GLuint(std::stoul(match[1].str()));
+        const std::string type = match[2].str();
+        std::string value = match[4].str();
+
+        auto given = std::ranges::find(constants, id, &SpecConstant::id);
+        if (given != constants.end()) {
+            if (type == "int")
+                value = std::to_string(std::bit_cast<int32_t>(given->value));
+            else if (type == "uint")
+                value = std::to_string(given->value) + "u";
+            else if (type == "float")
+                value = std::format("{:#}", std::bit_cast<float>(given->value));
+            else if (type == "bool")
+                value = given->value ? "true" : "false";
+        }
+
+        out.append(last, match[0].first);
+        out += std::format("const {} {} = {};", type, match[3].str(), value);
+        last = match[0].second;
+    }
+    out.append(last, source.cend());
+    source = std::move(out);
+}
+
+std::unique_ptr<Shader> ShaderLayer::make_shader(const std::string &common, const ShaderPass &spec,
+                                                 bool spirv)
+{
+    const auto &vertex = shaders::shadertoy_vertex;
+    const EmbeddedShader *fragment = spec.embedded;
+    // the SPIR-V was compiled without a common file
+    if (spirv && vertex.spirv_size && fragment && fragment->spirv_size && common.empty()) {
+        try {
+            return std::make_unique<Shader>(vertex.spirv, vertex.spirv_size,
+                                            fragment->spirv, fragment->spirv_size, spec.constants);
+        } catch (const std::exception &ex) {
+            fmt::println(stderr, "{}: SPIR-V didn't load, compiling its source instead\n{}",
+                         fragment->name, ex.what());
+        }
+    }
+    std::string source = build_source(common, spec);
+    return std::make_unique<Shader>(vertex.source, source.c_str());
+}
+
+ShaderLayer::ShaderLayer(const ShaderPasses &passes)
+: Layer()
+{
+    const bool spirv = Shader::spirv_supported();
+    auto make_pass = [&passes, spirv](const ShaderPass &spec) {
+        Pass pass;
+        pass.shader = make_shader(passes.common, spec, spirv);
+        pass.channels = spec.channels;
+        pass.scale = std::clamp(spec.scale, 0.0f, 1.0f);
+        return pass;
+    };
+
+    for (size_t i = 0; i < BUFFERS; i++) {
+        if (passes.buffers[i])
+            m_buffers[i] = make_pass(*passes.buffers[i]);
+    }
+    m_image = make_pass(passes.image);
+    m_checkerboard_allowed = passes.checkerboard;
+
+    // core profile draws need a vertex array, even an empty one
+    GL(glCreateVertexArrays(1, &m_vertex_array));
+
+    GLint alignment{};
+    GL(glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment));
+    alignment = std::max(alignment, GLint(1));
+    m_uniform_stride = div_round_up(sizeof(Uniforms), size_t(alignment)) * alignment;
+    m_uniforms.resize(m_uniform_stride * (BUFFERS + 1));
+
+    GL(glCreateBuffers(1, &m_uniform_buffer));
+    GL(glNamedBufferStorage(m_uniform_buffer, m_uniforms.size(), nullptr, GL_DYNAMIC_STORAGE_BIT));
+}
+
+ShaderLayer::~ShaderLayer()
+{
+    for (auto &pass : m_buffers) {
+        if (!pass)
+            continue;
+        GLState::current().delete_framebuffers(2, pass->fbo.data());
+        GL(glDeleteTextures(2, pass->texture.data()));
+    }
+    release_checkerboard();
+    GLState::current().delete_buffers(1, &m_uniform_buffer);
+    GLState::current().delete_vertex_arrays(1, &m_vertex_array);
+}
+
+void ShaderLayer::resize_buffer(Pass &pass, unsigned width, unsigned height)
+{
+    if (pass.width == width && pass.height == height)
+        return;
+
+    // contents are lost, as they are on ShaderToy when the window resizes
+    if (pass.fbo[0]) {
+        GLState::current().delete_framebuffers(2, pass.fbo.data());
+        GL(glDeleteTextures(2, pass.texture.data()));
+    }
+
+    GL(glCreateTextures(GL_TEXTURE_2D, 2, pass.texture.data()));
+    GL(glCreateFramebuffers(2, pass.fbo.data()));
+    for (size_t i = 0; i < 2; i++) {
+        GLuint texture = pass.texture[i];
+        GL(glTextureStorage2D(texture, 1, GL_RGBA16F, width, height));
+        GL(glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+        GL(glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+        GL(glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+        GL(glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+        GL(glClearTexImage(texture, 0, GL_RGBA, GL_FLOAT, nullptr));
+        GL(glNamedFramebufferTexture(pass.fbo[i], GL_COLOR_ATTACHMENT0, texture, 0));
+    }
+
+    pass.front = 0;
+    pass.width = width;
+    pass.height = height;
+}
+
+void ShaderLayer::release_checkerboard()
+{
+    if (!m_checker.fbo)
+        return;
+    GLState::current().delete_framebuffers(1, &m_checker.fbo);
+    GL(glDeleteTextures(1, &m_checker.texture));
+    GL(glDeleteRenderbuffers(1, &m_checker.stencil));
+    m_checker = {};
+}
+
+void ShaderLayer::resize_checkerboard(unsigned width, unsigned height)
+{
+    if (m_checker.fbo && m_checker.width == width && m_checker.height == height)
+        return;
+    release_checkerboard();
+
+    if (!m_stencil_shader) {
+        m_stencil_shader = std::make_unique<Shader>(shaders::shadertoy_vertex.source,
+                                                    shaders::checkerboard_stencil.source);
+        m_resolve_shader = std::make_unique<Shader>(shaders::shadertoy_vertex.source,
+                                                    shaders::checkerboard_resolve.source);
+    }
+
+    GL(glCreateTextures(GL_TEXTURE_2D, 1, &m_checker.texture));
+    GL(glTextureStorage2D(m_checker.texture, 1, GL_RGBA16F, width, height));
+    GL(glTextureParameteri(m_checker.texture, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+    GL(glTextureParameteri(m_checker.texture, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+    GL(glCreateRenderbuffers(1, &m_checker.stencil));
+    GL(glNamedRenderbufferStorage(m_checker.stencil, GL_STENCIL_INDEX8, width, height));
+    GL(glCreateFramebuffers(1, &m_checker.fbo));
+    GL(glNamedFramebufferTexture(m_checker.fbo, GL_COLOR_ATTACHMENT0, m_checker.texture, 0));
+    GL(glNamedFramebufferRenderbuffer(m_checker.fbo, GL_STENCIL_ATTACHMENT, GL_RENDERBUFFER,
+                                      m_checker.stencil));
+    m_checker.width = width;
+    m_checker.height = height;
+
+    // 1 in the blocks of odd parity, 0 in the rest
+    GLState &gl = GLState::current();
+    gl.bind_framebuffer(GL_DRAW_FRAMEBUFFER, m_checker.fbo);
+    gl.viewport(0, 0, width, height);
+    GLint zero = 0;
+    GL(glClearNamedFramebufferiv(m_checker.fbo, GL_STENCIL, 0, &zero));
+    GL(glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE));
+    GL(glEnable(GL_STENCIL_TEST));
+    GL(glStencilFunc(GL_ALWAYS, 1, 1));
+    GL(glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE));
+    m_stencil_shader->use();
+    GL(glDrawArrays(GL_TRIANGLES, 0, 3));
+    GL(glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP));
+    GL(glDisable(GL_STENCIL_TEST));
+    GL(glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE));
+}
+
+// the image pass into the checkerboard, then resolved into the view in target
+void ShaderLayer::render_checkerboard(GLuint target)
+{
+    GLState &gl = GLState::current();
+    resize_checkerboard(m_viewport.width, m_viewport.height);
+
+    // the first frame after a resize has nothing to fill in from, so shades it all
+    const GLint parity = m_checker.history ? (m_frame & 1) : 2;
+    gl.bind_framebuffer(GL_DRAW_FRAMEBUFFER, m_checker.fbo);
+    gl.viewport(0, 0, m_checker.width, m_checker.height);
+    if (parity < 2) {
+        GL(glEnable(GL_STENCIL_TEST));
+        GL(glStencilFunc(GL_EQUAL, parity, 1));
+    }
+    draw(BUFFERS, m_image);
+    if (parity < 2)
+        GL(glDisable(GL_STENCIL_TEST));
+    m_checker.history = true;
+
+    GL(glEnable(GL_SCISSOR_TEST));
+    gl.bind_framebuffer(GL_DRAW_FRAMEBUFFER, target);
+    gl.viewport(m_viewport.x, m_viewport.y, m_viewport.width, m_viewport.height);
+    GL(glBindTextureUnit(0, m_checker.texture));
+    m_resolve_shader->use();
+    gl.uniform(0, parity);
+    GL(glDrawArrays(GL_TRIANGLES, 0, 3));
+}
+
+void ShaderLayer::fill_uniforms(size_t slot, const Pass &pass, unsigned width, unsigned height)
+{
+    Uniforms u{};
+    u.iResolution[0] = float(width);
+    u.iResolution[1] = float(height);
+    u.iResolution[2] = 1.0f;
+    u.iTime = m_time;
+    u.iTimeDelta = m_time_delta;
+    u.iFrame = m_frame;
+    u.iFrameRate = m_time_delta > 0 ? 1.0f / m_time_delta : 0.0f;
+
+    for (size_t c = 0; c < 4; c++) {
+        if (pass.channels[c] == ShaderChannel::None)
+            continue;
+        const auto &source = m_buffers[size_t(pass.channels[c]) - 1];
+        if (!source)
+            continue;
+        u.iChannelResolution[c][0] = float(source->width);
+        u.iChannelResolution[c][1] = float(source->height);
+        u.iChannelResolution[c][2] = 1.0f;
+    }
+
+    time_t now = time(nullptr);
+    struct tm tm{};
+    localtime_r(&now, &tm);
+    u.iDate[0] = float(tm.tm_year + 1900);
+    u.iDate[1] = float(tm.tm_mon);
+    u.iDate[2] = float(tm.tm_mday);
+    u.iDate[3] = float(tm.tm_hour * 3600 + tm.tm_min * 60 + tm.tm_sec);
+
+    std::memcpy(m_uniforms.data() + slot * m_uniform_stride, &u, sizeof(u));
+}
+
+void ShaderLayer::on_update(const App &app, float timestamp)
+{
+    m_viewport = app.get_viewport();
+    // export workers render frames out of order, there is no frame before to keep
+    m_checkerboard = m_checkerboard_allowed && app.config().checkerboard
+                  && app.config().export_path.empty()
+                  && m_viewport.width && m_viewport.height;
+    if (app.config().export_path.empty()) {
+        // live, frames are counted as they render
+        m_time_delta = m_frame ? timestamp - m_time : 0.0f;
+    } else {
+        // each export worker sees every Nth frame, its number is in the timestamp
+        const double fps = app.config().export_fps;
+        m_frame = int32_t(std::lround(timestamp * fps));
+        m_time_delta = float(1.0 / fps);
+    }
+    m_time = timestamp;
+
+    for (size_t i = 0; i < BUFFERS; i++) {
+        auto &pass = m_buffers[i];
+        if (!pass)
+            continue;
+        unsigned width = std::max(1u, unsigned(std::lround(m_viewport.width * pass->scale)));
+        unsigned height = std::max(1u, unsigned(std::lround(m_viewport.height * pass->scale)));
+        resize_buffer(*pass, width, height);
+        fill_uniforms(i, *pass, width, height);
+    }
+    fill_uniforms(BUFFERS, m_image, m_viewport.width, m_viewport.height);
+
+    GL(glNamedBufferSubData(m_uniform_buffer, 0, m_uniforms.size(), m_uniforms.data()));
+}
+
+void ShaderLayer::bind_channels(const Pass &pass)
+{
+    for (size_t c = 0; c < 4; c++) {
+        GLuint texture = 0;
+        if (pass.channels[c] != ShaderChannel::None) {
+            const auto &source = m_buffers[size_t(pass.channels[c]) - 1];
+            if (source)
+                texture = source->texture[source->front];
+        }
+        GL(glBindTextureUnit(c, texture));
+    }
+}
+
+void ShaderLayer::draw(size_t slot, Pass &pass)
+{
+    bind_channels(pass);
+    GLState::current().bind_buffer_range(GL_UNIFORM_BUFFER, 0, m_uniform_buffer,
+                                         slot * m_uniform_stride, sizeof(Uniforms));
+    pass.shader->use();
+    GL(glDrawArrays(GL_TRIANGLES, 0, 3));
+}
+
+void ShaderLayer::on_render()
+{
+    GLState &gl = GLState::current();
+    GLuint target = gl.draw_framebuffer();
+    gl.bind_vertex_array(m_vertex_array);
+
+    // buffers cover all of their own texture, the App's scissor is for the view
+    GL(glDisable(GL_SCISSOR_TEST));
+    for (size_t i = 0; i < BUFFERS; i++) {
+        auto &pass = m_buffers[i];
+        if (!pass)
+            continue;
+        unsigned back = pass->front ^ 1;
+        gl.bind_framebuffer(GL_DRAW_FRAMEBUFFER, pass->fbo[back]);
+        gl.viewport(0, 0, pass->width, pass->height);
+        draw(i, *pass);
+        pass->front = back;
+    }
+
+    if (m_checkerboard) {
+        render_checkerboard(target);
+    } else {
+        release_checkerboard();
+        GL(glEnable(GL_SCISSOR_TEST));
+        gl.bind_framebuffer(GL_DRAW_FRAMEBUFFER, target);
+        gl.viewport(m_viewport.x, m_viewport.y, m_viewport.width, m_viewport.height);
+        draw(BUFFERS, m_image);
+    }
+
+    for (GLuint c = 0; c < 4; c++)
+        GL(glBindTextureUnit(c, 0));
+
+    m_frame ++;
+}
+
+}
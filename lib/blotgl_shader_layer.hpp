@@ -0,0 +1,150 @@
+#pragma once
+#include <array>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <GL/gl.h>
+#include <GL/glext.h>
+};
+
+#include "blotgl_app.hpp"
+#include "blotgl_embedded_shader.hpp"
+#include "blotgl_shader.hpp"
+
+namespace BlotGL {
+
+// what a pass's iChannelN samples
+enum class ShaderChannel {
+    None,
+    BufferA,
+    BufferB,
+    BufferC,
+    BufferD,
+};
+
+struct ShaderPass {
+    // ShaderToy style source, it defines mainImage(out vec4, in vec2): built
+    // into the binary with blotgl_target_shader(... SHADERTOY), see
+    // cmake/BlotGLShaders.cmake, or else read from a file
+    const EmbeddedShader *embedded{};
+    std::string path;
+    // values for the source's layout(constant_id = N) constants, the ones not
+    // given keep the value they are declared with
+    std::vector<SpecConstant> constants;
+    std::array<ShaderChannel,4> channels{};
+    // buffer passes render at this fraction of the view's resolution
+    float scale{1.0f};
+};
+
+struct ShaderPasses {
+    // optional file shared by all passes, like ShaderToy's Common tab; the
+    // passes are then compiled from source
+    std::string common;
+    // Buffer A..D, run in that order before the image
+    std::array<std::optional<ShaderPass>,4> buffers;
+    ShaderPass image;
+    // the image pass may be rendered in a checkerboard when BLOTGL_CHECKERBOARD
+    // is set: half of it each frame, the rest filled in from the frame before
+    bool checkerboard{false};
+};
+
+// A layer running a ShaderToy setup: up to four buffer passes that render into
+// their own ping-ponged textures, then the image pass that renders into the
+// layer's view.  A pass reading a buffer that already ran this frame sees this
+// frame's output; reading itself or a later buffer sees the previous frame's.
+// iResolution, iTime, iTimeDelta, iFrame, iFrameRate, iChannelResolution, iMouse
+// and iDate come from one uniform buffer; iChannel0..3 are texture units 0..3.
+// Embedded passes load as SPIR-V where the driver takes it, and are compiled
+// from their source where it doesn't.
+//
+// In a checkerboard, the image pass renders into a texture of the layer's own,
+// where a stencil holds a checkerboard of 4x4 pixel blocks (whole quads, and
+// whole tiles of software rasterizers, so the blocks left out are never
+// shaded).  Each frame shades the blocks of one parity; a resolve pass then
+// copies the texture into the view, holding the other blocks, still showing
+// the frame before, to the range of their neighbors.
+class ShaderLayer : public Layer {
+public:
+    static constexpr size_t BUFFERS = 4;
+
+protected:
+    // std140 layout of the ShaderToy uniform block
+    struct Uniforms {
+        float iResolution[3];
+        float iTime;
+        float iChannelResolution[4][4];
+        float iMouse[4];
+        float iDate[4];
+        float iTimeDelta;
+        int32_t iFrame;
+        float iFrameRate;
+        float unused;
+    };
+
+    struct Pass {
+        std::unique_ptr<Shader> shader;
+        std::array<ShaderChannel,4> channels{};
+        float scale{1.0f};
+        // buffer passes only: render into one texture while the other holds the last output
+        std::array<GLuint,2> fbo{};
+        std::array<GLuint,2> texture{};
+        unsigned front{};
+        unsigned width{};
+        unsigned height{};
+    };
+
+    std::array<std::optional<Pass>,BUFFERS> m_buffers;
+    Pass m_image;
+
+    // where the image pass renders in a checkerboard
+    struct Checkerboard {
+        GLuint fbo{};
+        GLuint texture{};
+        GLuint stencil{};
+        unsigned width{};
+        unsigned height{};
+        bool history{};     // it holds a whole earlier frame
+    };
+    bool m_checkerboard_allowed{};
+    bool m_checkerboard{};              // this frame
+    Checkerboard m_checker;
+    std::unique_ptr<Shader> m_stencil_shader;
+    std::unique_ptr<Shader> m_resolve_shader;
+
+    GLuint m_vertex_array{};
+    GLuint m_uniform_buffer{};
+    size_t m_uniform_stride{};          // per pass, rounded up to the binding alignment
+    std::vector<uint8_t> m_uniforms;    // staging for all passes, uploaded once per frame
+
+    Viewport m_viewport;
+    float m_time{};
+    float m_time_delta{};
+    int32_t m_frame{};
+
+    static std::string build_source(const std::string &common, const ShaderPass &spec);
+    static void specialize_source(std::string &source, const std::vector<SpecConstant> &constants);
+    static std::unique_ptr<Shader> make_shader(const std::string &common, const ShaderPass &spec,
+                                               bool spirv);
+    void resize_buffer(Pass &pass, unsigned width, unsigned height);
+    void fill_uniforms(size_t slot, const Pass &pass, unsigned width, unsigned height);
+    void bind_channels(const Pass &pass);
+    void draw(size_t slot, Pass &pass);
+    void release_checkerboard();
+    void resize_checkerboard(unsigned width, unsigned height);
+    void render_checkerboard(GLuint target);
+
+public:
+    explicit ShaderLayer(const ShaderPasses &passes);
+    ~ShaderLayer() override;
+
+    ShaderLayer(const ShaderLayer&) = delete;
+    ShaderLayer& operator=(const ShaderLayer&) = delete;
+
+    void on_update(const App &app, float timestamp) override;
+    void on_render() override;
+};
+
+}
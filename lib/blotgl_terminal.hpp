@@ -8,11 +8,17 @@ extern "C" {
 #include <unistd.h>
 }
 
+#define TERM_CSI           "\033["       // control sequence introducer
 #define TERM_COLOR_RESET   "\033[0m"      // reset current terminal color
+#define TERM_DEFAULT_BG    "\033[49m"     // reset background to the terminal default
 #define TERM_CLEAR_SCREEN  "\033[2J"      // clear the screen
 #define TERM_GOTO_TOP_LEFT "\033[H"       // place cursor at top-left
 #define TERM_ERASE_LINE    "\033[K"       // erase from current position to end
 #define TERM_CLEAR_LINE    "\033[2K"      // clear the entire line
+#define TERM_SYNC_BEGIN    "\033[?2026h" // hold screen updates until TERM_SYNC_END
+#define TERM_SYNC_END      "\033[?2026l"
+#define TERM_LR_MARGINS_ON  "\033[?69h"  // DECLRMM, CSI l;r s sets left and right margins
+#define TERM_LR_MARGINS_OFF "\033[?69l"  // back to full width, CSI s saves the cursor again
 
 inline winsize linux_terminal_winsize()
 {
@@ -0,0 +1,84 @@
+#include "blotgl_thread_pool.hpp"
+#include "blotgl_utils.hpp"
+
+#include <algorithm>
+
+namespace BlotGL {
+
+ThreadPool::ThreadPool(unsigned threads)
+{
+    if (!threads)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned i = 1; i < threads; i++)
+        m_workers.emplace_back(&ThreadPool::work, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (auto &worker : m_workers)
+        worker.join();
+}
+
+void ThreadPool::work()
+{
+    std::unique_lock lock(m_mutex);
+    uint64_t seen = 0;
+    for (;;) {
+        m_wake.wait(lock, [this, seen] { return m_stop || m_generation != seen; });
+        if (m_stop)
+            return;
+        seen = m_generation;
+        run_parts(lock);
+    }
+}
+
+void ThreadPool::run_parts(std::unique_lock<std::mutex> &lock)
+{
+    while (m_job && m_next < m_count) {
+        const auto &job = *m_job;
+        size_t begin = m_next;
+        size_t end = std::min(begin + m_grain, m_count);
+        m_next = end;
+        m_running ++;
+
+        lock.unlock();
+        job(begin, end);
+        lock.lock();
+
+        if (-- m_running == 0 && m_next >= m_count)
+            m_done.notify_all();
+    }
+}
+
+void ThreadPool::parallel_for(size_t count, size_t grain, const std::function<void(size_t, size_t)> &fn)
+{
+    if (!count)
+        return;
+    if (!grain)
+        grain = std::max<size_t>(1, div_round_up(count, size_t(threads()) * 4));
+    // not worth waking anyone for
+    if (m_workers.empty() || grain >= count) {
+        fn(0, count);
+        return;
+    }
+
+    std::unique_lock lock(m_mutex);
+    m_job = &fn;
+    m_count = count;
+    m_grain = grain;
+    m_next = 0;
+    m_running = 0;
+    m_generation ++;
+    m_wake.notify_all();
+
+    run_parts(lock);
+    m_done.wait(lock, [this] { return m_running == 0 && m_next >= m_count; });
+    m_job = nullptr;
+}
+
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace BlotGL {
+
+// A fixed set of worker threads that split a range of work between them and
+// the calling thread.  One job runs at a time; parallel_for() returns once
+// every part of it has.
+class ThreadPool final {
+protected:
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;     // a job was posted, or the pool stops
+    std::condition_variable m_done;     // the last part of the job finished
+
+    // the current job, under m_mutex
+    const std::function<void(size_t, size_t)> *m_job{};
+    size_t m_count{};
+    size_t m_grain{};
+    size_t m_next{};        // start of the next part to hand out
+    size_t m_running{};     // parts handed out and not finished
+    uint64_t m_generation{};
+    bool m_stop{};
+
+    void work();
+    // run parts of the current job until there are none left; lock is held on entry and exit
+    void run_parts(std::unique_lock<std::mutex> &lock);
+
+public:
+    // threads in all, counting the one calling parallel_for() (0 is one per core)
+    explicit ThreadPool(unsigned threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned threads() const { return unsigned(m_workers.size()) + 1; }
+
+    // fn(begin, end) over parts of [0, count), at least grain long (0 picks a
+    // few parts per thread), on every thread at once; returns when all are done
+    void parallel_for(size_t count, size_t grain, const std::function<void(size_t, size_t)> &fn);
+};
+
+}
@@ -0,0 +1,122 @@
+#define GL_GLEXT_PROTOTYPES
+#include "blotgl_trace.hpp"
+#include "blotgl_glerror.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fmt/core.h>
+
+namespace BlotGL {
+
+Tracer::Tracer(const std::string &path, size_t capacity, bool gpu)
+: m_path(path),
+  m_epoch(std::chrono::steady_clock::now()),
+  m_events(std::max<size_t>(capacity, 1)),
+  m_gpu_enabled(gpu)
+{
+    if (!m_gpu_enabled)
+        return;
+    GL(glGenQueries(m_queries.size(), m_queries.data()));
+
+    // line GPU timestamps up with now()
+    GLint64 gpu_now{};
+    GL(glGetInteger64v(GL_TIMESTAMP, &gpu_now));
+    m_gpu_offset_ns = int64_t(gpu_now) - int64_t(now());
+}
+
+Tracer::~Tracer()
+{
+    collect(true);
+    if (m_gpu_enabled)
+        GL(glDeleteQueries(m_queries.size(), m_queries.data()));
+    write();
+}
+
+void Tracer::gpu_begin(const char *name)
+{
+    if (!m_gpu_enabled)
+        return;
+    // the oldest span is still in flight, rather than wait for it this one is lost
+    GpuSpan &span = m_gpu[m_gpu_next];
+    if (span.pending) {
+        m_gpu_dropped ++;
+        m_gpu_open = GPU_SPANS;
+        return;
+    }
+
+    span = { .name = name, .frame = m_frame, .pending = false };
+    GL(glQueryCounter(m_queries[2 * m_gpu_next], GL_TIMESTAMP));
+    m_gpu_open = m_gpu_next;
+    m_gpu_next = (m_gpu_next + 1) % GPU_SPANS;
+}
+
+void Tracer::gpu_end()
+{
+    if (m_gpu_open == GPU_SPANS)
+        return;
+    GL(glQueryCounter(m_queries[2 * m_gpu_open + 1], GL_TIMESTAMP));
+    m_gpu[m_gpu_open].pending = true;
+    m_gpu_open = GPU_SPANS;
+}
+
+void Tracer::collect(bool wait)
+{
+    // oldest first, and stop at the first that isn't done, they finish in order
+    for (size_t i = 0; i < GPU_SPANS; i++) {
+        size_t index = (m_gpu_next + i) % GPU_SPANS;
+        GpuSpan &span = m_gpu[index];
+        if (!span.pending)
+            continue;
+
+        GLuint end = m_queries[2 * index + 1];
+        if (!wait) {
+            GLint available = 0;
+            GL(glGetQueryObjectiv(end, GL_QUERY_RESULT_AVAILABLE, &available));
+            if (!available)
+                return;
+        }
+
+        GLuint64 start_ns = 0, end_ns = 0;
+        GL(glGetQueryObjectui64v(m_queries[2 * index], GL_QUERY_RESULT, &start_ns));
+        GL(glGetQueryObjectui64v(end, GL_QUERY_RESULT, &end_ns));
+        span.pending = false;
+
+        // GPU timestamps count from somewhere else
+        uint64_t start = uint64_t(std::max<int64_t>(0, int64_t(start_ns) - m_gpu_offset_ns));
+        uint64_t duration = end_ns > start_ns ? end_ns - start_ns : 0;
+        record(span.name, start, start + duration, span.frame, Track::Gpu);
+    }
+}
+
+void Tracer::write() const
+{
+    FILE *file = fopen(m_path.c_str(), "w");
+    if (!file) {
+        fmt::println(stderr, "Failed to write trace {}", m_path);
+        return;
+    }
+
+    fmt::print(file, "{{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fmt::print(file, "{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{{\"name\":\"CPU\"}}}},\n");
+    fmt::print(file, "{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{{\"name\":\"GPU\"}}}}");
+
+    // oldest first; once the ring wrapped, that is the slot about to be overwritten
+    size_t size = m_events.size();
+    size_t count = std::min(m_count, size);
+    size_t first = m_count > size ? m_next : 0;
+    for (size_t i = 0; i < count; i++) {
+        const Event &e = m_events[(first + i) % size];
+        bool gpu = e.track == Track::Gpu;
+        fmt::print(file, ",\n{{\"name\":\"{}\",\"cat\":\"{}\",\"ph\":\"X\",\"pid\":1,\"tid\":{},"
+                         "\"ts\":{:.3f},\"dur\":{:.3f},\"args\":{{\"frame\":{}}}}}",
+                   e.name, gpu ? "gpu" : "cpu", gpu ? 2 : 1,
+                   e.start_ns / 1e3, e.duration_ns / 1e3, e.frame);
+    }
+    fmt::print(file, "\n]}}\n");
+    fclose(file);
+
+    fmt::println(stderr, "trace: {} events to {}{}", count, m_path,
+                 m_gpu_dropped ? fmt::format(", {} GPU spans dropped", m_gpu_dropped) : "");
+}
+
+}
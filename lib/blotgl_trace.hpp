@@ -0,0 +1,131 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <GL/gl.h>
+#include <GL/glext.h>
+};
+
+namespace BlotGL {
+
+// Records what each frame spends its time on, on the CPU and on the GPU, and
+// writes it out as Chrome trace-event JSON (chrome://tracing, ui.perfetto.dev).
+// Events go into a ring allocated up front, so recording is a few stores and
+// the oldest events are dropped when it is full.  GPU spans are pairs of
+// GL_TIMESTAMP queries, collected frames later once their results are ready.
+class Tracer final {
+public:
+    enum class Track : uint8_t { Cpu, Gpu };
+
+    struct Event {
+        const char *name;       // a string literal, never copied
+        uint64_t start_ns;
+        uint64_t duration_ns;
+        uint32_t frame;
+        Track track;
+    };
+
+protected:
+    static constexpr size_t GPU_SPANS = 32;    // in flight; a few frames' worth
+
+    struct GpuSpan {
+        const char *name{};
+        uint32_t frame{};
+        bool pending{};
+    };
+
+    std::string m_path;
+    std::chrono::steady_clock::time_point m_epoch;
+    std::vector<Event> m_events;
+    size_t m_next{};            // ring position of the next event
+    size_t m_count{};           // events recorded, may be more than the ring holds
+    uint32_t m_frame{};
+
+    std::array<GLuint, GPU_SPANS * 2> m_queries{};     // begin and end of each span
+    std::array<GpuSpan, GPU_SPANS> m_gpu{};
+    size_t m_gpu_next{};
+    size_t m_gpu_open{GPU_SPANS};   // span between gpu_begin() and gpu_end(), if any
+    size_t m_gpu_dropped{};
+    int64_t m_gpu_offset_ns{};      // GL_TIMESTAMP minus now()
+    bool m_gpu_enabled{};       // false: no GL, the GPU track stays empty
+
+    void record(const char *name, uint64_t start, uint64_t end, uint32_t frame, Track track) {
+        m_events[m_next] = { name, start, end > start ? end - start : 0, frame, track };
+        m_next = (m_next + 1) % m_events.size();
+        m_count ++;
+    }
+
+    void collect(bool wait);
+    void write() const;
+
+public:
+    // GL context must be current unless gpu is false, then the GPU track stays
+    // empty; the file is written when the tracer is destroyed
+    explicit Tracer(const std::string &path, size_t capacity, bool gpu = true);
+    ~Tracer();
+
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    uint64_t now() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now() - m_epoch).count();
+    }
+
+    // start of a frame, also picks up the GPU spans that have finished since
+    void begin_frame() {
+        m_frame ++;
+        collect(false);
+    }
+
+    void cpu(const char *name, uint64_t start, uint64_t end) {
+        record(name, start, end, m_frame, Track::Cpu);
+    }
+
+    // bracket GL commands, one span at a time
+    void gpu_begin(const char *name);
+    void gpu_end();
+};
+
+// records the enclosing scope on the CPU track, nothing when tracer is null
+class TraceSpan final {
+    Tracer *m_tracer;
+    const char *m_name;
+    uint64_t m_start;
+
+public:
+    TraceSpan(Tracer *tracer, const char *name)
+    : m_tracer(tracer), m_name(name), m_start(tracer ? tracer->now() : 0) { }
+    ~TraceSpan() {
+        if (m_tracer)
+            m_tracer->cpu(m_name, m_start, m_tracer->now());
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+};
+
+// records the GL commands issued in the enclosing scope on the GPU track
+class GpuTraceSpan final {
+    Tracer *m_tracer;
+
+public:
+    GpuTraceSpan(Tracer *tracer, const char *name)
+    : m_tracer(tracer) {
+        if (m_tracer)
+            m_tracer->gpu_begin(name);
+    }
+    ~GpuTraceSpan() {
+        if (m_tracer)
+            m_tracer->gpu_end();
+    }
+
+    GpuTraceSpan(const GpuTraceSpan&) = delete;
+    GpuTraceSpan& operator=(const GpuTraceSpan&) = delete;
+};
+
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <algorithm>
+#include <vector>
+
+namespace BlotGL {
+
+// Where a layer draws, as fractions of the terminal measured from its top-left
+// corner.  The default covers the whole screen.  Edges are snapped to whole
+// characters so panes never share a glyph.
+struct View {
+    float x{0.0f};
+    float y{0.0f};
+    float width{1.0f};
+    float height{1.0f};
+};
+
+// A View resolved to pixels of the render target, in GL's bottom-left origin.
+struct Viewport {
+    int x{};
+    int y{};
+    unsigned width{};
+    unsigned height{};
+};
+
+// where two viewports overlap, empty if they don't
+inline Viewport intersect(const Viewport &a, const Viewport &b)
+{
+    int x0 = std::max(a.x, b.x);
+    int y0 = std::max(a.y, b.y);
+    int x1 = std::min(a.x + int(a.width), b.x + int(b.width));
+    int y1 = std::min(a.y + int(a.height), b.y + int(b.height));
+    if (x1 <= x0 || y1 <= y0)
+        return { x0, y0, 0, 0 };
+    return { x0, y0, unsigned(x1 - x0), unsigned(y1 - y0) };
+}
+
+// the smallest viewport holding both
+inline Viewport bounding(const Viewport &a, const Viewport &b)
+{
+    int x0 = std::min(a.x, b.x);
+    int y0 = std::min(a.y, b.y);
+    int x1 = std::max(a.x + int(a.width), b.x + int(b.width));
+    int y1 = std::max(a.y + int(a.height), b.y + int(b.height));
+    return { x0, y0, unsigned(x1 - x0), unsigned(y1 - y0) };
+}
+
+// replace rects that overlap by their bounding box, until none do, and those
+// side by side that make up a rect together; what is left covers all of them
+// without any pixel in two
+inline void merge_rects(std::vector<Viewport> &rects)
+{
+    auto area = [](const Viewport &r) { return size_t(r.width) * r.height; };
+    auto mergeable = [&area](const Viewport &a, const Viewport &b) {
+        return intersect(a, b).width || area(bounding(a, b)) == area(a) + area(b);
+    };
+    for (bool merged = true; merged; ) {
+        merged = false;
+        for (size_t i = 0; i < rects.size(); i++) {
+            for (size_t j = i + 1; j < rects.size(); ) {
+                if (mergeable(rects[i], rects[j])) {
+                    rects[i] = bounding(rects[i], rects[j]);
+                    rects[j] = rects.back();
+                    rects.pop_back();
+                    merged = true;
+                } else {
+                    j++;
+                }
+            }
+        }
+    }
+}
+
+// Part of the screen in characters, from its top-left corner.
+struct CellRect {
+    unsigned x{};
+    unsigned y{};
+    unsigned width{};
+    unsigned height{};
+};
+
+}
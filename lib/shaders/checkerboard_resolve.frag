@@ -0,0 +1,27 @@
+#version 460 core
+// fills the checkerboard blocks not shaded this frame from the last, held to
+// the range of the blocks around them that were, see ShaderLayer
+layout(binding = 0) uniform sampler2D blotgl_shaded;
+// parity of the blocks shaded this frame, 2 when all were
+layout(location = 0) uniform int blotgl_parity;
+layout(location = 0) in vec2 v_TexCoord;
+layout(location = 0) out vec4 blotgl_FragColor;
+
+void main()
+{
+    ivec2 size = textureSize(blotgl_shaded, 0);
+    ivec2 p = ivec2(v_TexCoord * vec2(size));
+    vec4 color = texelFetch(blotgl_shaded, p, 0);
+
+    ivec2 block = p >> 2;
+    if (blotgl_parity < 2 && ((block.x + block.y) & 1) != blotgl_parity) {
+        // four pixels over is always the next block, which was shaded
+        ivec2 last = size - 1;
+        vec4 l = texelFetch(blotgl_shaded, clamp(p + ivec2(-4, 0), ivec2(0), last), 0);
+        vec4 r = texelFetch(blotgl_shaded, clamp(p + ivec2( 4, 0), ivec2(0), last), 0);
+        vec4 d = texelFetch(blotgl_shaded, clamp(p + ivec2(0, -4), ivec2(0), last), 0);
+        vec4 u = texelFetch(blotgl_shaded, clamp(p + ivec2(0,  4), ivec2(0), last), 0);
+        color = clamp(color, min(min(l, r), min(d, u)), max(max(l, r), max(d, u)));
+    }
+    blotgl_FragColor = color;
+}
@@ -0,0 +1,10 @@
+#version 460 core
+// marks the 4x4 pixel blocks of one checkerboard parity, see ShaderLayer;
+// blocks so whole quads, and the 4x4 tiles software rasterizers shade
+// together, are shaded or skipped as one
+void main()
+{
+    ivec2 block = ivec2(gl_FragCoord.xy) >> 2;
+    if (((block.x + block.y) & 1) == 0)
+        discard;
+}
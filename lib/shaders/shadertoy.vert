@@ -0,0 +1,9 @@
+#version 460 core
+// a triangle covering the viewport, generated from gl_VertexID
+layout(location = 0) out vec2 v_TexCoord;
+void main()
+{
+    vec2 pos = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    v_TexCoord = pos;
+    gl_Position = vec4(pos * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,5 @@
+// fragCoord from the texture coordinate, so it is relative to the view
+void main()
+{
+    mainImage(blotgl_FragColor, v_TexCoord * iResolution.xy);
+}
@@ -0,0 +1,17 @@
+#version 460 core
+layout(std140, binding = 0) uniform ShaderToy {
+    vec3 iResolution;
+    float iTime;
+    vec3 iChannelResolution[4];
+    vec4 iMouse;
+    vec4 iDate;
+    float iTimeDelta;
+    int iFrame;
+    float iFrameRate;
+};
+layout(binding = 0) uniform sampler2D iChannel0;
+layout(binding = 1) uniform sampler2D iChannel1;
+layout(binding = 2) uniform sampler2D iChannel2;
+layout(binding = 3) uniform sampler2D iChannel3;
+layout(location = 0) in vec2 v_TexCoord;
+layout(location = 0) out vec4 blotgl_FragColor;
@@ -0,0 +1,271 @@
+// blotpipe: raw RGB24 frames on stdin, drawn on the terminal without a GPU
+//
+//   ffmpeg -i in.mp4 -vf scale=200:-2 -f rawvideo -pix_fmt rgb24 - | blotpipe 200 112
+//
+// Frames are read straight into the Frame's pixel buffer and go through the
+// same conversion and encoding as App's, just without EGL/GBM.  When frames
+// arrive faster than the terminal takes them, the older ones are dropped
+// unread (spliced to /dev/null) and only the newest is drawn.
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <fmt/core.h>
+
+extern "C" {
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+};
+
+#include "blotgl_config.hpp"
+#include "blotgl_frame.hpp"
+#include "blotgl_probe.hpp"
+
+using namespace BlotGL;
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    unsigned width{};
+    unsigned height{};
+    double fps{0};          // pace a file at this rate, 0 is as fast as it comes
+    bool skip{true};        // drop frames the terminal can't keep up with
+};
+
+struct Stats {
+    size_t shown{};
+    size_t skipped{};
+    size_t bytes_out{};
+    double convert_ms{};
+    double encode_ms{};
+    double write_ms{};
+};
+
+static volatile sig_atomic_t g_interrupted = 0;
+
+static void sig_handler(int signo)
+{
+    g_interrupted = 1;
+}
+
+static double ms_since(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// fill dst from fd with as few reads as the kernel allows; false if the input ended first
+static bool read_frame(int fd, uint8_t *dst, size_t size)
+{
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = read(fd, dst + done, size - done);
+        if (n < 0 && errno == EINTR && !g_interrupted)
+            continue;
+        if (n <= 0)
+            return false;
+        done += size_t(n);
+    }
+    return true;
+}
+
+// Input is either a pipe, where frames are dropped by splicing them to /dev/null
+// without copying them in, or a file, where they are seeked over.
+class Input final {
+    int m_fd{STDIN_FILENO};
+    int m_null{-1};
+    bool m_pipe{false};
+    size_t m_pipe_size{};
+    size_t m_frame_bytes;
+
+public:
+    explicit Input(size_t frame_bytes)
+    : m_frame_bytes(frame_bytes) {
+        struct stat st{};
+        m_pipe = fstat(m_fd, &st) == 0 && (S_ISFIFO(st.st_mode) || S_ISSOCK(st.st_mode));
+        if (!m_pipe)
+            return;
+
+        // room for a few frames, so a backlog shows up in FIONREAD
+        fcntl(m_fd, F_SETPIPE_SZ, int(std::min<size_t>(4 * frame_bytes, 1 << 20)));
+        int size = fcntl(m_fd, F_GETPIPE_SZ);
+        m_pipe_size = size > 0 ? size_t(size) : 65536;
+        m_null = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    }
+    ~Input() {
+        if (m_null >= 0)
+            close(m_null);
+    }
+
+    Input(const Input&) = delete;
+    Input& operator=(const Input&) = delete;
+
+    int fd() const { return m_fd; }
+    bool pipe() const { return m_pipe; }
+
+    // whether another whole frame is already waiting behind the next one, or
+    // the pipe is full and the writer is blocked on us
+    bool behind() const {
+        if (!m_pipe)
+            return false;
+        int available = 0;
+        if (ioctl(m_fd, FIONREAD, &available) < 0)
+            return false;
+        return size_t(available) >= std::min(2 * m_frame_bytes, m_pipe_size);
+    }
+
+    // drop the next frame without reading it in; false if the input ended
+    bool skip(uint8_t *scratch) {
+        size_t left = m_frame_bytes;
+        if (!m_pipe) {
+            if (lseek(m_fd, off_t(left), SEEK_CUR) >= 0)
+                return true;
+        } else if (m_null >= 0) {
+            while (left) {
+                ssize_t n = splice(m_fd, nullptr, m_null, nullptr, left, SPLICE_F_MOVE);
+                if (n <= 0)
+                    break;
+                left -= size_t(n);
+            }
+            if (!left)
+                return true;
+        }
+        // neither works here, read the rest of it over the pixels that get replaced anyway
+        return read_frame(m_fd, scratch, left);
+    }
+};
+
+template <typename CELL>
+static int play(const Options &opt, const Config &config)
+{
+    Stats stats;
+    TerminalCaps caps = config.probe ? probe_terminal(config.probe_timeout_ms, config.probe < 2)
+                                     : TerminalCaps{};
+    Encoder encoder({
+        .color_tolerance = config.color_tolerance,
+        .truecolor = caps.truecolor,
+        .synchronized = caps.sync_output,
+    });
+    Screen screen({
+        .distance = config.delta_distance,
+        .refresh = config.delta_refresh,
+        .scroll = config.scroll,
+        .scroll_columns = caps.lr_margins,
+    });
+
+    // one frame for the whole run, the input is read into its pixels in place
+    FrameArena arena;
+    Frame<CELL> frame(opt.width, opt.height, arena);
+    const size_t frame_bytes = size_t(opt.width) * opt.height * 3;
+    Input input(frame_bytes);
+
+    auto start = Clock::now();
+    size_t index = 0;       // of the next frame in the input
+
+    // paced, and this frame's time has already passed
+    auto late = [&] {
+        return opt.fps > 0 && std::chrono::duration<double>(Clock::now() - start).count()
+                              > double(index + 1) / opt.fps;
+    };
+
+    while (!g_interrupted) {
+        // drop what the terminal can't keep up with: on a pipe the frames that
+        // piled up while it drained, when paced those whose time has passed
+        bool ended = false;
+        while (opt.skip && !ended && (input.behind() || late())) {
+            ended = !input.skip(frame.pixels());
+            if (!ended) {
+                stats.skipped ++;
+                index ++;
+            }
+        }
+        if (ended || !read_frame(input.fd(), frame.pixels(), frame_bytes))
+            break;
+        index ++;
+
+        if (opt.fps > 0) {
+            std::this_thread::sleep_until(start + std::chrono::duration_cast<Clock::duration>(
+                                              std::chrono::duration<double>((index - 1) / opt.fps)));
+        }
+
+        auto t0 = Clock::now();
+        frame.pixels_to_cells(false);
+        stats.convert_ms += ms_since(t0);
+
+        t0 = Clock::now();
+        if (config.delta)
+            frame.encode(encoder, screen);
+        else
+            frame.encode(encoder, !caps.sync_output);
+        stats.encode_ms += ms_since(t0);
+
+        t0 = Clock::now();
+        const auto &out = encoder.buffer();
+        std::fwrite(out.data(), 1, out.size(), stdout);
+        std::fflush(stdout);
+        stats.write_ms += ms_since(t0);
+
+        stats.bytes_out += out.size();
+        stats.shown ++;
+    }
+
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    double shown = std::max<size_t>(stats.shown, 1);
+    fmt::println(stderr, "\nblotpipe: {}x{} {} ({}): {} frames in, {} shown, {} skipped in {:.2f}s "
+                         "({:.1f} fps shown), {:.1f} KiB/frame, per frame: convert {:.3f} ms, "
+                         "encode {:.3f} ms, write {:.3f} ms",
+                 opt.width, opt.height, CELL::NAME, isa_name(frame.isa()), index, stats.shown, stats.skipped,
+                 seconds, stats.shown / std::max(seconds, 1e-9), stats.bytes_out / shown / 1024.0,
+                 stats.convert_ms / shown, stats.encode_ms / shown, stats.write_ms / shown);
+    return 0;
+}
+
+static void usage(const char *name)
+{
+    fmt::println(stderr, "usage: {} <width> <height> [--fps N] [--no-skip] < frames.rgb", name);
+    fmt::println(stderr, "  reads raw RGB24 frames, top row first, and draws them on the terminal");
+    fmt::println(stderr, "  BLOTGL_ENCODING, BLOTGL_COLOR_TOLERANCE, BLOTGL_DELTA*, BLOTGL_PROBE and BLOTGL_ISA apply");
+}
+
+int main(int argc, char *argv[])
+{
+    Options opt;
+    std::vector<const char*> positional;
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if (arg == "--fps" && i + 1 < argc)
+            opt.fps = std::atof(argv[++i]);
+        else if (arg == "--no-skip")
+            opt.skip = false;
+        else if (arg == "-h" || arg == "--help") {
+            usage(argv[0]);
+            return 0;
+        } else
+            positional.push_back(argv[i]);
+    }
+    if (positional.size() == 2) {
+        opt.width = unsigned(std::atoi(positional[0]));
+        opt.height = unsigned(std::atoi(positional[1]));
+    }
+    if (!opt.width || !opt.height) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    struct sigaction sa{};
+    sa.sa_handler = sig_handler;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGPIPE, &sa, NULL);
+
+    Config config = Config::from_env();
+    select_isa(config.isa);
+    return dispatch_cell_encoding(config.encoding, [&]<typename CELL>() {
+        return play<CELL>(opt, config);
+    });
+}
@@ -0,0 +1,141 @@
+// plotbench: how fast PlotLayer's CPU side takes samples in and gets a frame out
+//
+// Measures, without a GPU:
+//   - add: samples/s one Decimator folds in, single threaded
+//   - ingest: samples/s a producer thread gets through the SampleRings into
+//     the decimators, with a frame's columns taken out 60 times a second
+//   - frame: what taking a frame's columns costs, per width and window, which
+//     is what PlotLayer does before its one upload and draw
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <fmt/core.h>
+
+#include "blotgl_decimator.hpp"
+#include "blotgl_sample_ring.hpp"
+
+using namespace BlotGL;
+using Clock = std::chrono::steady_clock;
+
+static double seconds_since(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static std::vector<float> make_signal(size_t count)
+{
+    std::vector<float> samples(count);
+    for (size_t i = 0; i < count; i++)
+        samples[i] = float(std::sin(i * 0.001) + std::sin(i * 0.37) * 0.1);
+    return samples;
+}
+
+// keeps results alive so the work isn't optimized away
+static float g_sink;
+
+static void bench_add(double duration)
+{
+    auto signal = make_signal(1 << 16);
+    Decimator decimator(1 << 22);
+    size_t total = 0;
+    auto start = Clock::now();
+    while (seconds_since(start) < duration) {
+        for (int i = 0; i < 64; i++)
+            decimator.add(signal.data(), signal.size());
+        total += 64 * signal.size();
+    }
+    double seconds = seconds_since(start);
+    decimator.columns(1, [](size_t, const M4 &m4) { g_sink += m4.max; });
+    fmt::println("add:    {:7.1f} M samples/s into one decimator", total / seconds / 1e6);
+}
+
+static void bench_ingest(size_t series, size_t width, double duration)
+{
+    std::vector<std::shared_ptr<SampleRing>> rings;
+    std::vector<Decimator> decimators;
+    for (size_t s = 0; s < series; s++) {
+        rings.push_back(std::make_shared<SampleRing>(1 << 22));
+        decimators.emplace_back(1 << 22);
+    }
+
+    std::atomic<bool> stop{false};
+    std::thread producer([&] {
+        auto signal = make_signal(4096);
+        while (!stop) {
+            bool full = false;
+            for (auto &ring : rings)
+                full |= ring->write(signal.data(), signal.size()) < signal.size();
+            // as fast as the consumer keeps up, not faster
+            if (full)
+                std::this_thread::yield();
+        }
+    });
+
+    // the render thread: drain, then a frame's columns every 1/60 s
+    auto start = Clock::now();
+    auto next_frame = start;
+    size_t frames = 0, consumed = 0;
+    double frame_seconds = 0;
+    while (seconds_since(start) < duration) {
+        for (size_t s = 0; s < series; s++) {
+            consumed += rings[s]->read([&](const float *samples, size_t count) {
+                decimators[s].add(samples, count);
+            });
+        }
+        if (Clock::now() >= next_frame) {
+            auto t0 = Clock::now();
+            for (auto &decimator : decimators)
+                decimator.columns(width, [](size_t, const M4 &m4) { g_sink += m4.last; });
+            frame_seconds += seconds_since(t0);
+            frames ++;
+            next_frame += std::chrono::microseconds(16667);
+        }
+    }
+    double seconds = seconds_since(start);
+    stop = true;
+    producer.join();
+
+    fmt::println("ingest: {} series, {:7.1f} M samples/s drained, {} frames at {:.3f} ms",
+                 series, consumed / seconds / 1e6,
+                 frames, frame_seconds / std::max<size_t>(frames, 1) * 1e3);
+}
+
+static void bench_frame(size_t window, size_t width)
+{
+    auto signal = make_signal(window);
+    Decimator decimator(window);
+    decimator.add(signal.data(), signal.size());
+
+    size_t frames = 0;
+    auto start = Clock::now();
+    while (seconds_since(start) < 0.2) {
+        decimator.columns(width, [](size_t, const M4 &m4) { g_sink += m4.min; });
+        frames ++;
+    }
+    fmt::println("frame:  window {:>9}, {:>4} columns: {:7.2f} us per series",
+                 window, width, seconds_since(start) / frames * 1e6);
+}
+
+int main(int argc, char *argv[])
+{
+    double duration = argc > 1 ? std::atof(argv[1]) : 2.0;
+    if (duration <= 0) {
+        fmt::println(stderr, "usage: {} [seconds per test]", argv[0]);
+        return 1;
+    }
+    fmt::println("{} hardware threads", std::thread::hardware_concurrency());
+
+    bench_add(duration);
+    for (size_t series : { 1, 3, 8 })
+        bench_ingest(series, 400, duration);
+    for (size_t window : { size_t(1) << 16, size_t(1) << 20, size_t(1) << 24 })
+        for (size_t width : { 160, 400, 1000, 4000 })
+            bench_frame(window, width);
+
+    return g_sink == 12345.0f;
+}
@@ -0,0 +1,561 @@
+// ptybench: what an app's output costs to deliver through a terminal
+//
+//   ptybench [--size 200x60] [--seconds 5] [--parse] [--encodings braille,halfblock] -- command [args...]
+//
+// The FPS an App shows counts frames written, not frames a terminal got
+// through.  This runs the command on a pseudo-terminal of the given size, once
+// per encoding (BLOTGL_ENCODING is set for it, BLOTGL_PROBE=0 unless already
+// set, as nothing answers the probe), and drains the other side as fast as it
+// can.  With --parse the bytes also go through a VT parser stand-in, which
+// does what a terminal has to before it draws anything.  Per encoding it reports:
+//   - fps: frames delivered per second, counted by their cursor home
+//   - bytes per frame
+//   - syscalls per frame: the command's writes (from /proc/<pid>/io) and the reader's reads
+//   - parse time per frame, with --parse
+//
+// The command can be anything that draws frames, e.g. an app with BLOTGL_GL=0
+// for a host without a GPU, or blotpipe replaying a file:
+//
+//   ptybench --parse -- sh -c 'blotpipe 200 240 --no-skip < frames.rgb'
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fmt/core.h>
+
+extern "C" {
+#include <fcntl.h>
+#include <poll.h>
+#include <pty.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+};
+
+#include "blotgl_cell.hpp"
+
+using namespace BlotGL;
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    unsigned cols{200};
+    unsigned rows{60};
+    double seconds{5};
+    bool parse{false};
+    std::vector<CellEncoding> encodings;
+    std::vector<char*> command;
+};
+
+struct Result {
+    size_t frames{};
+    size_t bytes{};
+    size_t reads{};
+    long writes{-1};        // -1 if /proc/<pid>/io can't be read
+    double seconds{};
+    double parse_ms{};
+};
+
+static double ms_since(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Frames start with a cursor home (see Encoder::begin_frame()); the one after a
+// scroll region reset in the middle of a frame (see Encoder::scroll()) is not
+// another.  Kept apart from the parser, so frames count without --parse too.
+class FrameCounter final {
+    uint64_t m_window{};    // the last bytes seen, newest lowest
+    size_t m_frames{};
+
+public:
+    size_t frames() const { return m_frames; }
+
+    void feed(const char *data, size_t size) {
+        constexpr uint64_t HOME = 0x1b5b48;     // ESC [ H
+        constexpr uint64_t RESET = 0x1b5b72;    // ESC [ r
+        for (size_t i = 0; i < size; i++) {
+            m_window = m_window << 8 | uint8_t(data[i]);
+            if ((m_window & 0xffffff) == HOME && (m_window >> 24 & 0xffffff) != RESET)
+                m_frames ++;
+        }
+    }
+};
+
+// A stand-in for the terminal at the other end: decodes UTF-8, C0 controls,
+// escape and control sequences (with their parameters) the way a VT emulator
+// does, and applies what blotGL sends to a grid of cells: SGR colors, cursor
+// movement, erasing, scroll regions, scrolling and column shifts.  Strings
+// (OSC, DCS) and modes are parsed and ignored.  It draws nothing, so what it
+// costs is a floor under what a real terminal spends on the same bytes.
+class VtParser final {
+    struct Cell {
+        char32_t ch{' '};
+        uint32_t fg{};
+        uint32_t bg{};
+    };
+
+    enum class State { Ground, Escape, Csi, String, StringEscape };
+    static constexpr size_t MAX_PARAMS = 16;
+    static constexpr uint32_t DEFAULT = 1u << 24;   // not a 24-bit color
+
+    unsigned m_cols;
+    unsigned m_rows;
+    std::vector<Cell> m_grid;
+    unsigned m_x{}, m_y{};
+    unsigned m_top{}, m_bottom;     // scroll region, inclusive
+    uint32_t m_fg{DEFAULT}, m_bg{DEFAULT};
+
+    State m_state{State::Ground};
+    unsigned m_params[MAX_PARAMS]{};
+    size_t m_count{};
+    char m_private{};
+    char m_intermediate{};
+    char32_t m_codepoint{};
+    unsigned m_continuation{};      // UTF-8 bytes still to come
+
+    unsigned param(size_t i, unsigned fallback) const {
+        return i < m_count && m_params[i] ? m_params[i] : fallback;
+    }
+
+    Cell blank() const { return { ' ', m_fg, m_bg }; }
+
+    void erase(unsigned y, unsigned begin, unsigned end) {
+        std::fill(m_grid.begin() + y * m_cols + std::min(begin, m_cols),
+                  m_grid.begin() + y * m_cols + std::min(end, m_cols), blank());
+    }
+
+    // move rows of the scroll region up by n, negative n down
+    void scroll(int n) {
+        unsigned height = m_bottom - m_top + 1;
+        unsigned count = std::min(unsigned(std::abs(n)), height);
+        auto first = m_grid.begin() + m_top * m_cols;
+        auto last = m_grid.begin() + (m_bottom + 1) * m_cols;
+        if (n > 0) {
+            std::move(first + count * m_cols, last, first);
+            for (unsigned y = m_bottom + 1 - count; y <= m_bottom; y++)
+                erase(y, 0, m_cols);
+        } else {
+            std::move_backward(first, last - count * m_cols, last);
+            for (unsigned y = m_top; y < m_top + count; y++)
+                erase(y, 0, m_cols);
+        }
+    }
+
+    // move the columns of the scroll region's rows left by n, negative n right
+    void shift(int n) {
+        unsigned count = std::min(unsigned(std::abs(n)), m_cols);
+        for (unsigned y = m_top; y <= m_bottom; y++) {
+            auto first = m_grid.begin() + y * m_cols;
+            if (n > 0) {
+                std::move(first + count, first + m_cols, first);
+                erase(y, m_cols - count, m_cols);
+            } else {
+                std::move_backward(first, first + m_cols - count, first + m_cols);
+                erase(y, 0, count);
+            }
+        }
+    }
+
+    void line_feed() {
+        if (m_y == m_bottom)
+            scroll(1);
+        else if (m_y + 1 < m_rows)
+            m_y ++;
+    }
+
+    void print(char32_t ch) {
+        if (m_x >= m_cols) {
+            m_x = 0;
+            line_feed();
+        }
+        m_grid[m_y * m_cols + m_x++] = { ch, m_fg, m_bg };
+    }
+
+    // 38/48 ; 2 ; r ; g ; b or 38/48 ; 5 ; index, from parameter i on; returns the last used
+    size_t extended_color(size_t i, uint32_t &color) const {
+        if (param(i + 1, 0) == 2 && i + 4 < m_count) {
+            color = param(i + 2, 0) << 16 | param(i + 3, 0) << 8 | param(i + 4, 0);
+            return i + 4;
+        }
+        if (param(i + 1, 0) == 5 && i + 2 < m_count) {
+            color = param(i + 2, 0);
+            return i + 2;
+        }
+        return i;
+    }
+
+    void sgr() {
+        if (!m_count) {
+            m_fg = m_bg = DEFAULT;
+            return;
+        }
+        for (size_t i = 0; i < m_count; i++) {
+            unsigned p = m_params[i];
+            if (p == 0)
+                m_fg = m_bg = DEFAULT;
+            else if (p == 38)
+                i = extended_color(i, m_fg);
+            else if (p == 48)
+                i = extended_color(i, m_bg);
+            else if (p == 39)
+                m_fg = DEFAULT;
+            else if (p == 49)
+                m_bg = DEFAULT;
+            else if (p >= 30 && p <= 37)
+                m_fg = p - 30;
+            else if (p >= 40 && p <= 47)
+                m_bg = p - 40;
+        }
+    }
+
+    void csi(char final) {
+        if (m_private)
+            return;     // modes, DECRQM and the like change nothing on the grid
+        if (m_intermediate == ' ') {
+            if (final == '@')
+                shift(int(param(0, 1)));
+            else if (final == 'A')
+                shift(-int(param(0, 1)));
+            return;
+        }
+        switch (final) {
+            case 'H': case 'f':
+                m_y = std::min(param(0, 1), m_rows) - 1;
+                m_x = std::min(param(1, 1), m_cols) - 1;
+                break;
+            case 'A': m_y -= std::min(param(0, 1), m_y); break;
+            case 'B': m_y = std::min(m_y + param(0, 1), m_rows - 1); break;
+            case 'C': m_x = std::min(m_x + param(0, 1), m_cols - 1); break;
+            case 'D': m_x -= std::min(param(0, 1), m_x); break;
+            case 'G': m_x = std::min(param(0, 1), m_cols) - 1; break;
+            case 'X': erase(m_y, m_x, m_x + param(0, 1)); break;
+            case 'K':
+                if (param(0, 0) == 0)
+                    erase(m_y, m_x, m_cols);
+                else if (param(0, 0) == 1)
+                    erase(m_y, 0, m_x + 1);
+                else
+                    erase(m_y, 0, m_cols);
+                break;
+            case 'J':
+                if (param(0, 0) == 2 || param(0, 0) == 3) {
+                    std::fill(m_grid.begin(), m_grid.end(), blank());
+                } else {
+                    erase(m_y, m_x, m_cols);
+                    for (unsigned y = m_y + 1; y < m_rows; y++)
+                        erase(y, 0, m_cols);
+                }
+                break;
+            case 'm': sgr(); break;
+            case 'r':
+                m_top = std::min(param(0, 1), m_rows) - 1;
+                m_bottom = std::min(param(1, m_rows), m_rows) - 1;
+                if (m_bottom <= m_top) {
+                    m_top = 0;
+                    m_bottom = m_rows - 1;
+                }
+                m_x = m_y = 0;
+                break;
+            case 'S': scroll(int(param(0, 1))); break;
+            case 'T': scroll(-int(param(0, 1))); break;
+            default: break;
+        }
+    }
+
+    void ground(uint8_t byte) {
+        if (m_continuation) {
+            if ((byte & 0xc0) == 0x80) {
+                m_codepoint = m_codepoint << 6 | (byte & 0x3f);
+                if (!--m_continuation)
+                    print(m_codepoint);
+                return;
+            }
+            m_continuation = 0;
+            print(0xfffd);
+        }
+        if (byte >= 0x80) {
+            if ((byte & 0xe0) == 0xc0) {
+                m_codepoint = byte & 0x1f;
+                m_continuation = 1;
+            } else if ((byte & 0xf0) == 0xe0) {
+                m_codepoint = byte & 0x0f;
+                m_continuation = 2;
+            } else if ((byte & 0xf8) == 0xf0) {
+                m_codepoint = byte & 0x07;
+                m_continuation = 3;
+            } else {
+                print(0xfffd);
+            }
+            return;
+        }
+        switch (byte) {
+            case 0x1b: m_state = State::Escape; break;
+            case '\r': m_x = 0; break;
+            case '\n': line_feed(); break;
+            case '\b': m_x -= m_x > 0; break;
+            default:
+                if (byte >= 0x20 && byte < 0x7f)
+                    print(byte);
+                break;
+        }
+    }
+
+public:
+    VtParser(unsigned cols, unsigned rows)
+    : m_cols(cols), m_rows(rows), m_grid(size_t(cols) * rows), m_bottom(rows - 1) {}
+
+    void feed(const char *data, size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            uint8_t byte = uint8_t(data[i]);
+            switch (m_state) {
+                case State::Ground:
+                    ground(byte);
+                    break;
+                case State::Escape:
+                    if (byte == '[') {
+                        m_state = State::Csi;
+                        m_count = 0;
+                        m_params[0] = 0;
+                        m_private = m_intermediate = 0;
+                    } else if (byte == ']' || byte == 'P' || byte == '_' || byte == '^') {
+                        m_state = State::String;
+                    } else {
+                        m_state = State::Ground;    // ESC 7, ESC 8 and the like
+                    }
+                    break;
+                case State::Csi:
+                    if (byte >= '0' && byte <= '9') {
+                        if (!m_count)
+                            m_count = 1;
+                        if (m_count <= MAX_PARAMS)
+                            m_params[m_count - 1] = m_params[m_count - 1] * 10 + (byte - '0');
+                    } else if (byte == ';' || byte == ':') {
+                        if (!m_count)
+                            m_count = 1;
+                        if (++m_count <= MAX_PARAMS)
+                            m_params[m_count - 1] = 0;
+                    } else if (byte >= '<' && byte <= '?') {
+                        m_private = char(byte);
+                    } else if (byte >= 0x20 && byte <= 0x2f) {
+                        m_intermediate = char(byte);
+                    } else {
+                        m_count = std::min(m_count, MAX_PARAMS);
+                        if (byte >= 0x40 && byte <= 0x7e)
+                            csi(char(byte));
+                        m_state = State::Ground;
+                    }
+                    break;
+                case State::String:
+                    if (byte == 0x1b)
+                        m_state = State::StringEscape;
+                    else if (byte == 0x07)
+                        m_state = State::Ground;
+                    break;
+                case State::StringEscape:
+                    m_state = byte == '\\' ? State::Ground : State::String;
+                    break;
+            }
+        }
+    }
+
+    // something of the grid, so the work can't be optimized away
+    uint32_t checksum() const {
+        uint32_t sum = 0;
+        for (const Cell &cell : m_grid)
+            sum = sum * 31 + uint32_t(cell.ch) + cell.fg + cell.bg;
+        return sum;
+    }
+};
+
+// keeps the parser's grid alive so its work isn't optimized away
+static volatile uint32_t g_sink;
+
+// write syscalls the process made so far, -1 if not known
+static long write_syscalls(pid_t pid)
+{
+    std::string path = fmt::format("/proc/{}/io", pid);
+    FILE *file = std::fopen(path.c_str(), "r");
+    if (!file)
+        return -1;
+    long value = -1;
+    char line[128];
+    while (std::fgets(line, sizeof(line), file)) {
+        if (std::sscanf(line, "syscw: %ld", &value) == 1)
+            break;
+    }
+    std::fclose(file);
+    return value;
+}
+
+static bool run(const Options &opt, CellEncoding encoding, Result &result)
+{
+    winsize ws{};
+    ws.ws_col = uint16_t(opt.cols);
+    ws.ws_row = uint16_t(opt.rows);
+
+    int master = -1;
+    pid_t pid = forkpty(&master, nullptr, nullptr, &ws);
+    if (pid < 0) {
+        fmt::println(stderr, "forkpty: {}", strerror(errno));
+        return false;
+    }
+    if (pid == 0) {
+        setenv("BLOTGL_ENCODING", cell_encoding_name(encoding), 1);
+        setenv("BLOTGL_PROBE", "0", 0);
+        execvp(opt.command[0], opt.command.data());
+        fmt::println(stderr, "{}: {}", opt.command[0], strerror(errno));
+        _exit(127);
+    }
+
+    FrameCounter counter;
+    VtParser parser(opt.cols, opt.rows);
+    std::vector<char> buffer(1 << 16);
+
+    // timed from the first frame, so startup isn't counted
+    bool started = false;
+    size_t first_frames = 0;
+    long first_writes = 0;
+    Clock::time_point start{}, deadline = Clock::now() + std::chrono::seconds(30);
+
+    for (;;) {
+        auto now = Clock::now();
+        if (now >= deadline)
+            break;
+        pollfd pfd{ master, POLLIN, 0 };
+        int timeout = int(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count()) + 1;
+        int rc = poll(&pfd, 1, timeout);
+        if (rc < 0 && errno == EINTR)
+            continue;
+        if (rc <= 0)
+            continue;
+        ssize_t n = read(master, buffer.data(), buffer.size());
+        if (n <= 0)
+            break;      // EIO once the command has exited
+
+        counter.feed(buffer.data(), size_t(n));
+        if (!started) {
+            if (!counter.frames())
+                continue;
+            started = true;
+            first_frames = counter.frames();
+            first_writes = write_syscalls(pid);
+            start = Clock::now();
+            deadline = start + std::chrono::duration_cast<Clock::duration>(
+                                   std::chrono::duration<double>(opt.seconds));
+        }
+        result.reads ++;
+        result.bytes += size_t(n);
+        if (opt.parse) {
+            auto t0 = Clock::now();
+            parser.feed(buffer.data(), size_t(n));
+            result.parse_ms += ms_since(t0);
+        }
+    }
+
+    if (started) {
+        result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        result.frames = counter.frames() - first_frames;
+        long writes = write_syscalls(pid);
+        if (writes >= 0 && first_writes >= 0)
+            result.writes = writes - first_writes;
+    }
+
+    // stop it, and drain whatever it still writes so it isn't blocked on a full pty
+    kill(pid, SIGTERM);
+    for (;;) {
+        pollfd pfd{ master, POLLIN, 0 };
+        if (poll(&pfd, 1, 1000) <= 0 || read(master, buffer.data(), buffer.size()) <= 0)
+            break;
+    }
+    close(master);
+    int status = 0;
+    waitpid(pid, &status, 0);
+
+    g_sink = g_sink + parser.checksum();
+    return started;
+}
+
+static void usage(const char *name)
+{
+    fmt::println(stderr, "usage: {} [--size COLSxROWS] [--seconds S] [--parse] [--encodings a,b,...] -- command [args...]", name);
+    fmt::println(stderr, "  runs the command on a pseudo-terminal once per encoding, and reports the frames");
+    fmt::println(stderr, "  delivered, their bytes and syscalls, and with --parse what parsing them costs");
+}
+
+int main(int argc, char *argv[])
+{
+    Options opt;
+    int i = 1;
+    for (; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if (arg == "--") {
+            i++;
+            break;
+        } else if (arg == "--size" && i + 1 < argc) {
+            if (std::sscanf(argv[++i], "%ux%u", &opt.cols, &opt.rows) != 2)
+                opt.cols = 0;
+        } else if (arg == "--seconds" && i + 1 < argc) {
+            opt.seconds = std::atof(argv[++i]);
+        } else if (arg == "--parse") {
+            opt.parse = true;
+        } else if (arg == "--encodings" && i + 1 < argc) {
+            std::string_view list = argv[++i];
+            while (!list.empty()) {
+                size_t comma = std::min(list.find(','), list.size());
+                auto encoding = parse_cell_encoding(list.substr(0, comma));
+                if (!encoding) {
+                    fmt::println(stderr, "unknown encoding {}", list.substr(0, comma));
+                    return 1;
+                }
+                opt.encodings.push_back(*encoding);
+                list.remove_prefix(std::min(comma + 1, list.size()));
+            }
+        } else if (arg == "-h" || arg == "--help") {
+            usage(argv[0]);
+            return 0;
+        } else {
+            break;
+        }
+    }
+    for (; i < argc; i++)
+        opt.command.push_back(argv[i]);
+    opt.command.push_back(nullptr);
+
+    if (opt.command.size() < 2 || !opt.cols || !opt.rows || opt.seconds <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (opt.encodings.empty())
+        opt.encodings = { CellEncoding::Braille, CellEncoding::Braille2, CellEncoding::HalfBlock,
+                          CellEncoding::Quadrant, CellEncoding::Sextant };
+
+    // the reader outlives a command that dies on its own
+    signal(SIGPIPE, SIG_IGN);
+
+    fmt::println("{}x{} cells, {:.1f}s each{}; all but fps per frame", opt.cols, opt.rows,
+                 opt.seconds, opt.parse ? ", parsed" : "");
+    fmt::println("{:<10} {:>8} {:>11} {:>8} {:>8} {:>10}",
+                 "encoding", "fps", "KiB/frame", "writes", "reads", "parse ms");
+    int failed = 0;
+    for (CellEncoding encoding : opt.encodings) {
+        Result result;
+        if (!run(opt, encoding, result) || !result.frames) {
+            fmt::println("{:<10} no frames", cell_encoding_name(encoding));
+            failed = 1;
+            continue;
+        }
+        double frames = double(result.frames);
+        fmt::println("{:<10} {:8.1f} {:11.1f} {:>8} {:8.2f} {:>10}",
+                     cell_encoding_name(encoding), frames / result.seconds,
+                     result.bytes / frames / 1024.0,
+                     result.writes >= 0 ? fmt::format("{:.2f}", result.writes / frames) : "-",
+                     result.reads / frames,
+                     opt.parse ? fmt::format("{:.3f}", result.parse_ms / frames) : "-");
+    }
+    return failed;
+}